@@ -0,0 +1,207 @@
+#include "cipherClient.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <thread>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace {
+
+// Число проверок готовности до уступки процессора другим потокам;
+// с тем же периодом проверяется, что сервис еще работает
+const unsigned spinLimit = 64;
+
+std::string systemError(const std::string& what)
+{
+    return what + ": " + std::strerror(errno);
+}
+
+} // namespace
+
+cipherClient::cipherClient(const std::string& socketPath, uint32_t ringSlots, uint32_t ringSlotChars) :
+    fd(-1), ring(nullptr), bytes(0), slots(ringSlots), slotChars(ringSlotChars), head(0), tail(0), waits(0)
+{
+    sockaddr_un addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (socketPath.empty() || socketPath.size() >= sizeof(addr.sun_path))
+        throw service_error("Invalid socket path");
+    std::strcpy(addr.sun_path, socketPath.c_str());
+
+    fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0)
+        throw service_error(systemError("socket"));
+    if (connect(fd, (sockaddr*)&addr, sizeof(addr)) < 0) {
+        std::string error = systemError("connect");
+        close(fd);
+        throw service_error(error);
+    }
+
+    try {
+        controlRequest req;
+        std::memset(&req, 0, sizeof(req));
+        req.command = controlCommand::openRing;
+        req.arg = slots;
+        req.length = slotChars;
+        controlReply rep = request(req);
+
+        int shm = shm_open(rep.text, O_RDWR, 0);
+        if (shm < 0)
+            throw service_error(systemError("shm_open"));
+        bytes = ringBytes(slots, slotChars);
+        ring = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, shm, 0);
+        close(shm);
+        if (ring == MAP_FAILED) {
+            ring = nullptr;
+            throw service_error(systemError("mmap"));
+        }
+    } catch (...) {
+        close(fd);
+        throw;
+    }
+}
+
+cipherClient::~cipherClient()
+{
+    if (ring)
+        munmap(ring, bytes);
+    close(fd);
+}
+
+controlReply cipherClient::request(const controlRequest& req)
+{
+    controlReply rep;
+    if (!writeAll(fd, &req, sizeof(req)) || !readAll(fd, &rep, sizeof(rep)))
+        throw service_error("Connection to cipher service lost");
+    if (rep.status != 0) {
+        rep.text[sizeof(rep.text) - 1] = '\0';
+        throw service_error(rep.text);
+    }
+    return rep;
+}
+
+slotHeader* cipherClient::slot(uint64_t n)
+{
+    return slotAt(ring, n % slots, slotChars);
+}
+
+// Без запроса сервис в сокет не пишет: готовность сокета к чтению
+// означает, что сервис закрыл соединение
+void cipherClient::checkConnection()
+{
+    pollfd p = {fd, POLLIN, 0};
+    int r = ::poll(&p, 1, 0);
+    if (r > 0 || (r < 0 && errno != EINTR))
+        throw service_error("Cipher service closed the connection");
+}
+
+uint32_t cipherClient::addKey(const std::wstring& key)
+{
+    if (key.size() > maxKeyLength)
+        throw service_error("Key is too long");
+
+    controlRequest req;
+    std::memset(&req, 0, sizeof(req));
+    req.command = controlCommand::addGronsfeldKey;
+    req.length = key.size();
+    std::copy(key.begin(), key.end(), req.key);
+    return request(req).value;
+}
+
+uint32_t cipherClient::addKey(int columns)
+{
+    controlRequest req;
+    std::memset(&req, 0, sizeof(req));
+    req.command = controlCommand::addRouteKey;
+    req.arg = columns;
+    return request(req).value;
+}
+
+wchar_t* cipherClient::reserve()
+{
+    if (head - tail == slots)
+        return nullptr;
+    return slotText(slot(head));
+}
+
+void cipherClient::submit(uint32_t keyId, requestOp op, size_t length)
+{
+    if (head - tail == slots)
+        throw service_error("Ring is full");
+    if (length > slotChars)
+        throw service_error("Request does not fit into slot");
+
+    slotHeader* s = slot(head++);
+    s->op.store(op, std::memory_order_relaxed);
+    s->keyId.store(keyId, std::memory_order_relaxed);
+    s->length.store(length, std::memory_order_relaxed);
+    s->state.store(slotSubmitted);
+
+    // Сервис мог уснуть до появления запроса - будим его через сокет
+    ringHeader* header = (ringHeader*)ring;
+    if (header->sleeping.load()) {
+        controlRequest req;
+        std::memset(&req, 0, sizeof(req));
+        req.command = controlCommand::wake;
+        if (!writeAll(fd, &req, sizeof(req)))
+            throw service_error("Connection to cipher service lost");
+    }
+}
+
+bool cipherClient::poll(completion& c)
+{
+    if (tail == head)
+        return false;
+
+    slotHeader* s = slot(tail);
+    uint32_t state = s->state.load(std::memory_order_acquire);
+    if (state != slotDone && state != slotFailed) {
+        if (++waits % spinLimit == 0)
+            checkConnection();
+        return false;
+    }
+    waits = 0;
+
+    c.ok = state == slotDone;
+    c.text = slotText(s);
+    c.length = s->length;
+    c.error = c.ok ? "" : s->error;
+    return true;
+}
+
+void cipherClient::release()
+{
+    if (tail == head)
+        throw service_error("No request to release");
+    slot(tail++)->state.store(slotFree, std::memory_order_release);
+}
+
+std::wstring cipherClient::process(uint32_t keyId, requestOp op, const std::wstring& text)
+{
+    if (text.size() > slotChars)
+        throw service_error("Request does not fit into slot");
+    // Синхронный запрос дожидается всех ранее отправленных
+    if (tail != head)
+        throw service_error("Asynchronous requests are pending");
+
+    wchar_t* buffer = reserve();
+    std::copy(text.begin(), text.end(), buffer);
+    submit(keyId, op, text.size());
+
+    completion c;
+    for (unsigned spins = 0; !poll(c); spins++) {
+        if (spins >= spinLimit)
+            std::this_thread::yield();
+    }
+
+    std::wstring result(c.text, c.length);
+    release();
+    if (!c.ok)
+        throw service_error(c.error);
+    return result;
+}
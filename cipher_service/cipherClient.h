@@ -0,0 +1,59 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include "cipherProtocol.h"
+
+// Результат запроса, текст остается в слоте кольца до release()
+struct completion {
+    bool ok;
+    const wchar_t* text;
+    size_t length;
+    std::string error;
+};
+
+// Клиент локального сервиса шифрования.
+// Запросы пакетами записываются в кольцо: reserve() дает буфер слота,
+// submit() отправляет его; результаты забираются по порядку через poll()
+class cipherClient
+{
+private:
+    int fd;
+    void* ring;
+    size_t bytes;
+    uint32_t slots;
+    uint32_t slotChars;
+    uint64_t head;   // следующий слот для отправки
+    uint64_t tail;   // самый старый неосвобожденный слот
+    unsigned waits;  // число подряд неготовых результатов
+
+    controlReply request(const controlRequest& req);
+    slotHeader* slot(uint64_t n);
+    void checkConnection();
+
+public:
+    cipherClient() = delete;
+    cipherClient(const cipherClient&) = delete;
+    cipherClient& operator=(const cipherClient&) = delete;
+    cipherClient(const std::string& socketPath, uint32_t ringSlots = 64, uint32_t ringSlotChars = 1 << 16);
+    ~cipherClient();
+
+    // Регистрация ключей, возвращает номер ключа в сервисе
+    uint32_t addKey(const std::wstring& key);
+    uint32_t addKey(int columns);
+
+    // Буфер следующего слота для записи текста или nullptr, если кольцо заполнено
+    wchar_t* reserve();
+    size_t capacity() const { return slotChars; }
+    // Отправка зарезервированного слота с текстом длины length.
+    // Текст должен быть нормализован (только прописные буквы алфавита)
+    void submit(uint32_t keyId, requestOp op, size_t length);
+
+    // Результат самого старого запроса, false - еще не готов.
+    // Если сервис завершился, не обработав запрос, - service_error
+    bool poll(completion& c);
+    // Освобождение слота самого старого запроса
+    void release();
+
+    // Синхронный запрос с копированием текста в кольцо и обратно
+    std::wstring process(uint32_t keyId, requestOp op, const std::wstring& text);
+};
@@ -0,0 +1,61 @@
+#include "cipherProtocol.h"
+#include <cerrno>
+#include <unistd.h>
+#include <sys/socket.h>
+
+namespace {
+
+const size_t ringHeaderBytes = 64;
+
+} // namespace
+
+size_t slotBytes(uint32_t slotChars)
+{
+    return (sizeof(slotHeader) + slotChars * sizeof(wchar_t) + 63) / 64 * 64;
+}
+
+size_t ringBytes(uint32_t slots, uint32_t slotChars)
+{
+    return ringHeaderBytes + slots * slotBytes(slotChars);
+}
+
+slotHeader* slotAt(void* ring, uint32_t i, uint32_t slotChars)
+{
+    return (slotHeader*)((char*)ring + ringHeaderBytes + i * slotBytes(slotChars));
+}
+
+wchar_t* slotText(slotHeader* slot)
+{
+    return (wchar_t*)(slot + 1);
+}
+
+bool writeAll(int fd, const void* data, size_t size)
+{
+    const char* p = (const char*)data;
+    while (size > 0) {
+        // MSG_NOSIGNAL: закрытый собеседником сокет не должен завершать процесс по SIGPIPE
+        ssize_t n = send(fd, p, size, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return false;
+        p += n;
+        size -= n;
+    }
+    return true;
+}
+
+bool readAll(int fd, void* data, size_t size)
+{
+    char* p = (char*)data;
+    while (size > 0) {
+        ssize_t n = read(fd, p, size);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return false;
+        p += n;
+        size -= n;
+    }
+    return true;
+}
@@ -0,0 +1,88 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+#include <stdexcept>
+#include <string>
+
+// Локальный сервис шифрования: управление через Unix-сокет,
+// тексты запросов - в кольцевом буфере разделяемой памяти клиента.
+// Сервис шифрует и расшифровывает тексты прямо в слотах кольца, без копирования
+
+class service_error : public std::runtime_error {
+public:
+    explicit service_error(const std::string& what_arg) :
+        std::runtime_error(what_arg) {}
+    explicit service_error(const char* what_arg) :
+        std::runtime_error(what_arg) {}
+};
+
+static_assert(ATOMIC_INT_LOCK_FREE == 2, "shared memory ring needs lock-free atomics");
+
+// Команды управляющего канала
+enum class controlCommand : uint32_t {
+    openRing = 1,          // arg - число слотов, length - емкость слота в символах
+    addGronsfeldKey = 2,   // key - ключ шифра Гронсфельда
+    addRouteKey = 3,       // arg - число столбцов маршрутной перестановки
+    wake = 4               // пробуждение сервиса после отправки запросов, без ответа
+};
+
+// Операции над текстом слота
+enum class requestOp : uint32_t {
+    encrypt = 1,
+    decrypt = 2
+};
+
+// Состояния слота кольца
+enum slotState : uint32_t {
+    slotFree = 0,
+    slotSubmitted = 1,
+    slotDone = 2,
+    slotFailed = 3
+};
+
+const size_t maxKeyLength = 256;
+const uint32_t maxSlots = 4096;
+const uint32_t maxSlotChars = 1 << 24;
+
+struct controlRequest {
+    controlCommand command;
+    uint32_t arg;
+    uint32_t length;
+    wchar_t key[maxKeyLength];
+};
+
+struct controlReply {
+    int32_t status;        // 0 - успех, -1 - ошибка с описанием в text
+    uint32_t value;        // номер ключа
+    char text[120];        // имя разделяемой памяти или текст ошибки
+};
+
+// Заголовок кольца в начале разделяемой памяти.
+// Клиент может изменить любые поля, поэтому сервис берет размеры кольца
+// только из своей копии, сделанной при создании
+struct ringHeader {
+    std::atomic<uint32_t> sleeping;   // сервис ждет на сокете и нуждается в пробуждении
+    uint32_t slots;
+    uint32_t slotChars;
+};
+
+// Заголовок слота; за ним следует текст запроса из slotChars символов.
+// Параметры запроса - атомарные, чтобы сервис читал каждый ровно один раз
+struct slotHeader {
+    std::atomic<uint32_t> state;
+    std::atomic<requestOp> op;
+    std::atomic<uint32_t> keyId;
+    std::atomic<uint32_t> length;
+    char error[112];
+};
+
+// Размещение кольца: заголовок, затем слоты, выровненные по 64 байта
+size_t slotBytes(uint32_t slotChars);
+size_t ringBytes(uint32_t slots, uint32_t slotChars);
+slotHeader* slotAt(void* ring, uint32_t i, uint32_t slotChars);
+wchar_t* slotText(slotHeader* slot);
+
+// Передача управляющих сообщений целиком
+bool writeAll(int fd, const void* data, size_t size);
+bool readAll(int fd, void* data, size_t size);
@@ -0,0 +1,404 @@
+#include "cipherServer.h"
+#include <algorithm>
+#include <iterator>
+#include <chrono>
+#include <cerrno>
+#include <cstring>
+#include <new>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace {
+
+// Число пустых проверок кольца до засыпания на сокете;
+// после первых spinPure проверок процессор уступается другим потокам
+const unsigned spinLimit = 1 << 14;
+const unsigned spinPure = 64;
+
+// Период проверки флага остановки, мс
+const int pollInterval = 100;
+
+// Управляющее сообщение должно быть передано целиком за это время, мс
+const int controlTimeout = 1000;
+
+std::string systemError(const std::string& what)
+{
+    return what + ": " + std::strerror(errno);
+}
+
+bool submitted(void* ring, uint32_t cursor, uint32_t slotChars)
+{
+    return slotAt(ring, cursor, slotChars)->state.load() == slotSubmitted;
+}
+
+// Ожидание готовности сокета; false - срок истек, сервис остановлен или ошибка
+bool waitSocket(int fd, short events, std::chrono::steady_clock::time_point deadline,
+                const std::atomic<bool>& running)
+{
+    while (running && std::chrono::steady_clock::now() < deadline) {
+        pollfd p = {fd, events, 0};
+        int r = poll(&p, 1, pollInterval);
+        if (r > 0)
+            return true;
+        if (r < 0 && errno != EINTR)
+            return false;
+    }
+    return false;
+}
+
+// Передача управляющего сообщения без блокировки: клиент, отправивший часть
+// запроса или не читающий ответы, не задерживает поток дольше controlTimeout
+// и не мешает остановке сервиса
+bool transferControl(int fd, void* data, size_t size, bool out, const std::atomic<bool>& running)
+{
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(controlTimeout);
+    char* p = (char*)data;
+    while (size > 0) {
+        if (!waitSocket(fd, out ? POLLOUT : POLLIN, deadline, running))
+            return false;
+        ssize_t n = out ? send(fd, p, size, MSG_NOSIGNAL | MSG_DONTWAIT)
+                         : recv(fd, p, size, MSG_DONTWAIT);
+        if (n < 0 && (errno == EINTR || errno == EAGAIN || errno == EWOULDBLOCK))
+            continue;
+        if (n <= 0)
+            return false;
+        p += n;
+        size -= n;
+    }
+    return true;
+}
+
+// Удаление сокета, оставшегося от завершившегося сервиса. Другие файлы
+// и сокет, который еще принимает соединения, не трогаются
+void removeStaleSocket(const sockaddr_un& addr)
+{
+    struct stat st;
+    if (lstat(addr.sun_path, &st) < 0)
+        return;
+    if (!S_ISSOCK(st.st_mode))
+        throw service_error("Socket path is occupied by another file");
+
+    int probe = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (probe < 0)
+        throw service_error(systemError("socket"));
+    int r = connect(probe, (const sockaddr*)&addr, sizeof(addr));
+    int error = errno;
+    close(probe);
+    if (r == 0)
+        throw service_error("Another cipher service is listening on the socket path");
+    errno = error;
+    if (error != ECONNREFUSED)
+        throw service_error(systemError("connect"));
+
+    unlink(addr.sun_path);
+}
+
+} // namespace
+
+cipherServer::cipherServer(const std::string& path) :
+    socketPath(path), listenFd(-1), running(true), ringCounter(0)
+{
+    sockaddr_un addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (path.empty() || path.size() >= sizeof(addr.sun_path))
+        throw service_error("Invalid socket path");
+    std::strcpy(addr.sun_path, path.c_str());
+    removeStaleSocket(addr);
+
+    listenFd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listenFd < 0)
+        throw service_error(systemError("socket"));
+
+    if (bind(listenFd, (sockaddr*)&addr, sizeof(addr)) < 0 || listen(listenFd, 16) < 0) {
+        std::string error = systemError("bind");
+        close(listenFd);
+        throw service_error(error);
+    }
+}
+
+cipherServer::~cipherServer()
+{
+    stop();
+    for (auto& s : sessions) {
+        if (s.thread.joinable())
+            s.thread.join();
+    }
+    close(listenFd);
+    unlink(socketPath.c_str());
+}
+
+void cipherServer::stop()
+{
+    running = false;
+}
+
+size_t cipherServer::activeSessions()
+{
+    std::lock_guard<std::mutex> lock(sessionsMutex);
+    size_t count = 0;
+    for (auto& s : sessions) {
+        if (!s.done)
+            count++;
+    }
+    return count;
+}
+
+void cipherServer::run()
+{
+    while (running) {
+        reapSessions();
+
+        pollfd p = {listenFd, POLLIN, 0};
+        if (poll(&p, 1, pollInterval) <= 0)
+            continue;
+
+        int fd = accept(listenFd, nullptr, nullptr);
+        if (fd < 0)
+            continue;
+
+        std::lock_guard<std::mutex> lock(sessionsMutex);
+        sessions.emplace_back();
+        sessionThread& th = sessions.back();
+        th.done = false;
+        th.thread = std::thread(&cipherServer::serve, this, fd, &th.done);
+    }
+
+    // Потоки присоединяются вне sessionsMutex, чтобы activeSessions()
+    // не ждал завершения сеансов
+    std::list<sessionThread> finished;
+    {
+        std::lock_guard<std::mutex> lock(sessionsMutex);
+        finished.swap(sessions);
+    }
+    for (auto& s : finished) {
+        s.thread.join();
+    }
+}
+
+// Потоки отключившихся клиентов присоединяются сразу, не дожидаясь остановки
+// сервиса, иначе их стеки накапливаются
+void cipherServer::reapSessions()
+{
+    std::list<sessionThread> finished;
+    {
+        std::lock_guard<std::mutex> lock(sessionsMutex);
+        for (auto it = sessions.begin(); it != sessions.end();) {
+            auto next = std::next(it);
+            if (it->done)
+                finished.splice(finished.end(), sessions, it);
+            it = next;
+        }
+    }
+    for (auto& s : finished) {
+        s.thread.join();
+    }
+}
+
+// Обслуживание клиента: запросы из кольца берутся по порядку;
+// после spinLimit пустых проверок поток засыпает на сокете до запроса или сообщения
+void cipherServer::serve(int fd, std::atomic<bool>* done)
+{
+    session s = {fd, nullptr, 0, "", 0, 0, 0};
+    unsigned idle = 0;
+
+    while (running) {
+        if (s.ring && submitted(s.ring, s.cursor, s.slotChars)) {
+            process(slotAt(s.ring, s.cursor, s.slotChars), s.slotChars);
+            s.cursor = (s.cursor + 1) % s.slots;
+            idle = 0;
+            continue;
+        }
+        if (s.ring && idle < spinLimit) {
+            if (++idle > spinPure)
+                std::this_thread::yield();
+            continue;
+        }
+
+        // Флаг выставляется до последней проверки кольца, а клиент проверяет его
+        // после отправки запроса, поэтому запрос не может остаться незамеченным
+        ringHeader* header = (ringHeader*)s.ring;
+        if (header) {
+            header->sleeping.store(1);
+            if (submitted(s.ring, s.cursor, s.slotChars)) {
+                header->sleeping.store(0);
+                continue;
+            }
+        }
+
+        pollfd p = {fd, POLLIN, 0};
+        int r = poll(&p, 1, pollInterval);
+        if (header)
+            header->sleeping.store(0);
+
+        if (r < 0 && errno != EINTR)
+            break;
+        // Опрос кольца возобновляется только после сообщения клиента;
+        // по истечении pollInterval поток снова засыпает на сокете
+        if (r > 0) {
+            if (!handleControl(s))
+                break;
+            idle = 0;
+        }
+    }
+
+    closeSession(s);
+    *done = true;
+}
+
+// Обработка управляющего сообщения; false - клиент отключился
+bool cipherServer::handleControl(session& s)
+{
+    controlRequest req;
+    if (!transferControl(s.fd, &req, sizeof(req), false, running))
+        return false;
+
+    controlReply rep;
+    std::memset(&rep, 0, sizeof(rep));
+    try {
+        switch (req.command) {
+        case controlCommand::openRing:
+            openRing(s, req, rep);
+            break;
+        case controlCommand::addGronsfeldKey:
+        case controlCommand::addRouteKey:
+            rep.value = addKey(req);
+            break;
+        case controlCommand::wake:
+            return true;
+        default:
+            throw service_error("Unknown command");
+        }
+    } catch (const std::exception& e) {
+        rep.status = -1;
+        std::strncpy(rep.text, e.what(), sizeof(rep.text) - 1);
+    }
+
+    return transferControl(s.fd, &rep, sizeof(rep), true, running);
+}
+
+// Создание кольца клиента в разделяемой памяти
+void cipherServer::openRing(session& s, const controlRequest& req, controlReply& rep)
+{
+    if (s.ring)
+        throw service_error("Ring is already open");
+    if (req.arg == 0 || req.arg > maxSlots || req.length == 0 || req.length > maxSlotChars)
+        throw service_error("Invalid ring size");
+
+    std::string name = "/cipherd." + std::to_string(getpid()) + "." + std::to_string(ringCounter++);
+    size_t bytes = ringBytes(req.arg, req.length);
+
+    int shm = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+    if (shm < 0)
+        throw service_error(systemError("shm_open"));
+    void* ring = MAP_FAILED;
+    if (ftruncate(shm, bytes) == 0) {
+        ring = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, shm, 0);
+    }
+    close(shm);
+    if (ring == MAP_FAILED) {
+        std::string error = systemError("mmap");
+        shm_unlink(name.c_str());
+        throw service_error(error);
+    }
+
+    ringHeader* header = new (ring) ringHeader();
+    header->slots = req.arg;
+    header->slotChars = req.length;
+    for (uint32_t i = 0; i < req.arg; i++) {
+        new (slotAt(ring, i, req.length)) slotHeader();
+    }
+
+    s.ring = ring;
+    s.bytes = bytes;
+    s.shmName = name;
+    s.slots = req.arg;
+    s.slotChars = req.length;
+    s.cursor = 0;
+    std::strncpy(rep.text, name.c_str(), sizeof(rep.text) - 1);
+}
+
+// Регистрация ключа; одинаковые ключи разных клиентов получают один номер
+uint32_t cipherServer::addKey(const controlRequest& req)
+{
+    std::unique_ptr<keyEntry> entry(new keyEntry());
+    if (req.command == controlCommand::addGronsfeldKey) {
+        entry->type = cipherType::gronsfeld;
+        entry->key.assign(req.key, std::min((size_t)req.length, maxKeyLength));
+        entry->columns = 0;
+    } else {
+        entry->type = cipherType::route;
+        entry->columns = req.arg;
+    }
+
+    std::lock_guard<std::mutex> lock(keysMutex);
+    for (size_t i = 0; i < keys.size(); i++) {
+        if (keys[i]->type == entry->type && keys[i]->key == entry->key && keys[i]->columns == entry->columns)
+            return i;
+    }
+
+    if (entry->type == cipherType::gronsfeld)
+        entry->gronsfeld.reset(new modAlphaCipher(entry->key));
+    else
+        entry->route.reset(new routeCipher(entry->columns));
+    keys.push_back(std::move(entry));
+    return keys.size() - 1;
+}
+
+cipherServer::keyEntry* cipherServer::findKey(uint32_t id)
+{
+    std::lock_guard<std::mutex> lock(keysMutex);
+    if (id >= keys.size())
+        throw service_error("Unknown key");
+    return keys[id].get();
+}
+
+// Выполнение запроса прямо в слоте кольца. Параметры запроса читаются
+// из разделяемой памяти один раз и проверяются уже в локальных копиях
+void cipherServer::process(slotHeader* slot, uint32_t slotChars)
+{
+    try {
+        requestOp op = slot->op.load(std::memory_order_relaxed);
+        uint32_t keyId = slot->keyId.load(std::memory_order_relaxed);
+        uint32_t length = slot->length.load(std::memory_order_relaxed);
+
+        if (length > slotChars)
+            throw service_error("Request does not fit into slot");
+        if (op != requestOp::encrypt && op != requestOp::decrypt)
+            throw service_error("Unknown operation");
+
+        keyEntry* key = findKey(keyId);
+        wchar_t* text = slotText(slot);
+        bool encrypt = op == requestOp::encrypt;
+        if (key->type == cipherType::gronsfeld) {
+            if (encrypt)
+                key->gronsfeld->encryptInPlace(text, length);
+            else
+                key->gronsfeld->decryptInPlace(text, length);
+        } else {
+            if (encrypt)
+                key->route->encryptInPlace(text, length);
+            else
+                key->route->decryptInPlace(text, length);
+        }
+        slot->state.store(slotDone, std::memory_order_release);
+    } catch (const std::exception& e) {
+        std::strncpy(slot->error, e.what(), sizeof(slot->error) - 1);
+        slot->error[sizeof(slot->error) - 1] = '\0';
+        slot->state.store(slotFailed, std::memory_order_release);
+    }
+}
+
+void cipherServer::closeSession(session& s)
+{
+    if (s.ring) {
+        munmap(s.ring, s.bytes);
+        shm_unlink(s.shmName.c_str());
+    }
+    close(s.fd);
+}
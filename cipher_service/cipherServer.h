@@ -0,0 +1,78 @@
+#pragma once
+#include <atomic>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "cipherProtocol.h"
+#include "modAlphaCipher.h"
+#include "routeCipher.h"
+
+// Сервис шифрования для нескольких процессов одной машины.
+// Ключи создаются один раз и общие для всех клиентов; каждый клиент
+// получает собственное кольцо в разделяемой памяти, которое обслуживает
+// отдельный поток: он опрашивает кольцо, а при простое засыпает на сокете
+class cipherServer
+{
+private:
+    // Зарегистрированный ключ одного из шифров
+    struct keyEntry {
+        cipherType type;
+        std::wstring key;
+        int columns;
+        std::unique_ptr<modAlphaCipher> gronsfeld;
+        std::unique_ptr<routeCipher> route;
+    };
+
+    // Состояние сеанса одного клиента. Размеры кольца хранятся здесь:
+    // копии в разделяемой памяти клиент может изменить
+    struct session {
+        int fd;
+        void* ring;
+        size_t bytes;
+        std::string shmName;
+        uint32_t slots;
+        uint32_t slotChars;
+        uint32_t cursor;
+    };
+
+    // Поток сеанса; done выставляется при его завершении
+    struct sessionThread {
+        std::thread thread;
+        std::atomic<bool> done;
+    };
+
+    std::string socketPath;
+    int listenFd;
+    std::atomic<bool> running;
+    std::atomic<uint32_t> ringCounter;
+
+    std::mutex keysMutex;
+    std::vector<std::unique_ptr<keyEntry>> keys;
+
+    std::mutex sessionsMutex;
+    std::list<sessionThread> sessions;
+
+    void serve(int fd, std::atomic<bool>* done);
+    void reapSessions();
+    bool handleControl(session& s);
+    void openRing(session& s, const controlRequest& req, controlReply& rep);
+    uint32_t addKey(const controlRequest& req);
+    keyEntry* findKey(uint32_t id);
+    void process(slotHeader* slot, uint32_t slotChars);
+    void closeSession(session& s);
+
+public:
+    cipherServer() = delete;
+    cipherServer(const std::string& path);
+    ~cipherServer();
+
+    // Прием клиентов до вызова stop()
+    void run();
+    // Остановка; допускается вызов из обработчика сигнала
+    void stop();
+    // Число подключенных клиентов
+    size_t activeSessions();
+};
@@ -0,0 +1,37 @@
+#include "cipherServer.h"
+#include <csignal>
+#include <iostream>
+#include <locale>
+
+using namespace std;
+
+// Сервис шифрования: cipherd [путь к сокету]
+
+cipherServer* server = nullptr;
+
+extern "C" void onSignal(int)
+{
+    if (server)
+        server->stop();
+}
+
+int main(int argc, char** argv)
+{
+    std::locale::global(std::locale("ru_RU.UTF-8"));
+    string path = argc > 1 ? argv[1] : "/tmp/cipherd.sock";
+    
+    try {
+        cipherServer s(path);
+        server = &s;
+        signal(SIGINT, onSignal);
+        signal(SIGTERM, onSignal);
+        
+        cerr << "cipherd: listening on " << path << endl;
+        s.run();
+        server = nullptr;
+    } catch (const exception& e) {
+        cerr << "cipherd: " << e.what() << endl;
+        return 1;
+    }
+    return 0;
+}
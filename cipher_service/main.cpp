@@ -0,0 +1,330 @@
+#include <UnitTest++/UnitTest++.h>
+#include "cipherServer.h"
+#include "cipherClient.h"
+#include <locale>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <memory>
+#include <thread>
+#include <chrono>
+#include <cwchar>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+using namespace std;
+
+// Глобальная настройка локали
+struct LocaleSetup {
+    LocaleSetup() {
+        std::locale::global(std::locale("ru_RU.UTF-8"));
+    }
+};
+
+LocaleSetup localeSetup;
+
+// Сервис, запущенный в отдельном потоке на время теста
+struct ServerFixture {
+    string path;
+    cipherServer* server;
+    thread worker;
+
+    ServerFixture() {
+        path = "/tmp/cipherd_test." + to_string(getpid()) + ".sock";
+        server = new cipherServer(path);
+        worker = thread(&cipherServer::run, server);
+    }
+
+    ~ServerFixture() {
+        server->stop();
+        if (worker.joinable())
+            worker.join();
+        delete server;
+    }
+};
+
+// Ожидание условия не дольше секунды
+template <class Condition>
+bool waitFor(Condition done)
+{
+    for (int i = 0; i < 1000; i++) {
+        if (done())
+            return true;
+        this_thread::sleep_for(chrono::milliseconds(1));
+    }
+    return done();
+}
+
+// Соединение с сервисом в обход cipherClient; -1 при ошибке
+int connectSocket(const string& path)
+{
+    sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, path.c_str());
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd >= 0 && connect(fd, (sockaddr*)&addr, sizeof(addr)) < 0) {
+        close(fd);
+        fd = -1;
+    }
+    return fd;
+}
+
+// ==================== ТЕСТЫ УПРАВЛЯЮЩЕГО КАНАЛА ====================
+
+SUITE(ControlTest)
+{
+    TEST_FIXTURE(ServerFixture, SharedKeys) {
+        cipherClient first(path);
+        cipherClient second(path);
+        uint32_t key = first.addKey(L"КЛЮЧ");
+        CHECK_EQUAL(key, second.addKey(L"КЛЮЧ"));
+        CHECK(key != second.addKey(5));
+    }
+
+    TEST_FIXTURE(ServerFixture, InvalidKeys) {
+        cipherClient client(path);
+        CHECK_THROW(client.addKey(L"К1"), service_error);
+        CHECK_THROW(client.addKey(0), service_error);
+    }
+
+    TEST(NoServer) {
+        CHECK_THROW(cipherClient("/tmp/cipherd_test.missing.sock"), service_error);
+    }
+
+    TEST_FIXTURE(ServerFixture, InvalidRing) {
+        CHECK_THROW(cipherClient(path, 0), service_error);
+    }
+    
+    TEST_FIXTURE(ServerFixture, FinishedSessions) {
+        // Потоки отключившихся клиентов освобождаются, не дожидаясь остановки
+        for (int i = 0; i < 3; i++) {
+            cipherClient client(path);
+            client.addKey(3);
+        }
+        CHECK(waitFor([this]() { return server->activeSessions() == 0; }));
+        cipherClient client(path);
+        CHECK(waitFor([this]() { return server->activeSessions() == 1; }));
+    }
+    
+    TEST_FIXTURE(ServerFixture, OccupiedPath) {
+        // Чужой файл и сокет работающего сервиса не удаляются
+        string file = path + ".file";
+        close(open(file.c_str(), O_CREAT | O_WRONLY, 0600));
+        CHECK_THROW(cipherServer server(file), service_error);
+        CHECK(access(file.c_str(), F_OK) == 0);
+        unlink(file.c_str());
+        
+        CHECK_THROW(cipherServer second(path), service_error);
+        cipherClient client(path);
+        CHECK_EQUAL(client.addKey(3), client.addKey(3));
+    }
+    
+    TEST(StaleSocket) {
+        // Сокет завершившегося сервиса заменяется новым
+        string path = "/tmp/cipherd_test." + to_string(getpid()) + ".stale.sock";
+        sockaddr_un addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sun_family = AF_UNIX;
+        strcpy(addr.sun_path, path.c_str());
+        int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        CHECK(bind(fd, (sockaddr*)&addr, sizeof(addr)) == 0);
+        close(fd);
+        
+        cipherServer server(path);
+        thread worker(&cipherServer::run, &server);
+        cipherClient client(path);
+        CHECK(client.process(client.addKey(3), requestOp::encrypt, L"АБВГДЕ") == L"ВЕБДАГ");
+        server.stop();
+        worker.join();
+    }
+    
+    TEST_FIXTURE(ServerFixture, StalledClient) {
+        // Клиент отправил часть запроса и замолчал: сервис отвечает
+        // на activeSessions() и быстро останавливается
+        int fd = connectSocket(path);
+        CHECK(fd >= 0);
+        controlRequest req;
+        memset(&req, 0, sizeof(req));
+        req.command = controlCommand::addRouteKey;
+        CHECK(writeAll(fd, &req, 10));
+        CHECK(waitFor([this]() { return server->activeSessions() == 1; }));
+        this_thread::sleep_for(chrono::milliseconds(150));
+        
+        auto start = chrono::steady_clock::now();
+        server->stop();
+        worker.join();
+        CHECK(chrono::steady_clock::now() - start < chrono::milliseconds(500));
+        close(fd);
+    }
+}
+
+// ==================== ТЕСТЫ ЗАПРОСОВ ====================
+
+SUITE(RequestTest)
+{
+    TEST_FIXTURE(ServerFixture, Gronsfeld) {
+        cipherClient client(path);
+        uint32_t key = client.addKey(L"КЛЮЧ");
+        wstring encrypted = client.process(key, requestOp::encrypt, L"ПРОГРАММИРОВАНИЕ");
+        CHECK(encrypted == modAlphaCipher(L"КЛЮЧ").encrypt(L"ПРОГРАММИРОВАНИЕ"));
+        CHECK(client.process(key, requestOp::decrypt, encrypted) == L"ПРОГРАММИРОВАНИЕ");
+    }
+
+    TEST_FIXTURE(ServerFixture, Route) {
+        cipherClient client(path);
+        uint32_t key = client.addKey(4);
+        CHECK(client.process(key, requestOp::encrypt, L"АБВГДЕЁЖ") == L"ГЖВЁБЕАД");
+        CHECK(client.process(key, requestOp::decrypt, L"ГВЁБЕАД") == L"АБВГДЕЁ");
+    }
+
+    TEST_FIXTURE(ServerFixture, Batch) {
+        // Кольцо заполняется целиком, затем результаты забираются по порядку
+        cipherClient client(path, 8, 64);
+        uint32_t key = client.addKey(L"Б");
+        wstring text = L"АБВГДЕЁЖЗИЙК";
+        for (size_t i = 0; i < 8; i++) {
+            wchar_t* buffer = client.reserve();
+            CHECK(buffer != nullptr);
+            text.copy(buffer, i + 1);
+            client.submit(key, requestOp::encrypt, i + 1);
+        }
+        CHECK(client.reserve() == nullptr);
+
+        wstring expected = L"БВГДЕЁЖЗИЙКЛ";
+        for (size_t i = 0; i < 8; i++) {
+            completion c;
+            while (!client.poll(c)) {
+            }
+            CHECK(c.ok);
+            CHECK(wstring(c.text, c.length) == expected.substr(0, i + 1));
+            client.release();
+        }
+        CHECK(client.reserve() != nullptr);
+    }
+
+    TEST_FIXTURE(ServerFixture, AfterIdle) {
+        // Запрос после засыпания сервиса будит его через сокет
+        cipherClient client(path);
+        uint32_t key = client.addKey(3);
+        this_thread::sleep_for(chrono::milliseconds(50));
+        CHECK(client.process(key, requestOp::encrypt, L"АБВГДЕ") == L"ВЕБДАГ");
+    }
+
+    TEST_FIXTURE(ServerFixture, IdleClients) {
+        // Заснувшие потоки сеансов не возвращаются к опросу колец
+        // по каждому таймауту сокета и почти не тратят процессор
+        vector<unique_ptr<cipherClient>> clients;
+        for (int i = 0; i < 4; i++) {
+            clients.emplace_back(new cipherClient(path));
+            uint32_t key = clients.back()->addKey(3);
+            CHECK(clients.back()->process(key, requestOp::encrypt, L"АБВГДЕ") == L"ВЕБДАГ");
+        }
+        this_thread::sleep_for(chrono::milliseconds(200));
+        
+        auto cpuTime = []() {
+            rusage u;
+            getrusage(RUSAGE_SELF, &u);
+            return chrono::seconds(u.ru_utime.tv_sec + u.ru_stime.tv_sec)
+                   + chrono::microseconds(u.ru_utime.tv_usec + u.ru_stime.tv_usec);
+        };
+        auto start = cpuTime();
+        this_thread::sleep_for(chrono::milliseconds(500));
+        CHECK(cpuTime() - start < chrono::milliseconds(50));
+    }
+    
+    TEST_FIXTURE(ServerFixture, FailedRequest) {
+        cipherClient client(path, 4, 16);
+        uint32_t key = client.addKey(L"КЛЮЧ");
+        CHECK_THROW(client.process(key, requestOp::encrypt, L"не нормализован"), service_error);
+        CHECK_THROW(client.process(key + 100, requestOp::encrypt, L"АБВ"), service_error);
+        CHECK_THROW(client.process(key, requestOp::encrypt, wstring(17, L'А')), service_error);
+        CHECK(client.process(key, requestOp::decrypt, L"ЪЬЭА") == modAlphaCipher(L"КЛЮЧ").decrypt(L"ЪЬЭА"));
+    }
+    
+    TEST_FIXTURE(ServerFixture, ServerStopped) {
+        // Клиент, ожидающий результат, узнает о завершении сервиса
+        cipherClient client(path);
+        cipherClient batch(path);
+        uint32_t key = client.addKey(L"КЛЮЧ");
+        server->stop();
+        worker.join();
+        
+        CHECK_THROW(client.process(key, requestOp::encrypt, L"АБВ"), service_error);
+        bool failed = false;
+        try {
+            wcscpy(batch.reserve(), L"АБВ");
+            batch.submit(key, requestOp::encrypt, 3);
+            completion c;
+            while (!batch.poll(c)) {
+            }
+        } catch (const service_error&) {
+            failed = true;
+        }
+        CHECK(failed);
+    }
+    
+    TEST_FIXTURE(ServerFixture, HostileRing) {
+        // Сервис не доверяет размерам кольца и длине запроса в разделяемой памяти
+        cipherClient client(path, 4, 16);
+        uint32_t key = client.addKey(L"КЛЮЧ");
+        
+        // Кольцо первого клиента сервиса
+        string name = "/cipherd." + to_string(getpid()) + ".0";
+        int shm = shm_open(name.c_str(), O_RDWR, 0);
+        CHECK(shm >= 0);
+        void* ring = mmap(nullptr, ringBytes(4, 16), PROT_READ | PROT_WRITE, MAP_SHARED, shm, 0);
+        close(shm);
+        CHECK(ring != MAP_FAILED);
+        if (shm < 0 || ring == MAP_FAILED)
+            return;
+        
+        ringHeader* header = (ringHeader*)ring;
+        header->slots = 0;
+        header->slotChars = maxSlotChars;
+        
+        slotHeader* first = slotAt(ring, 0, 16);
+        first->op = requestOp::encrypt;
+        first->keyId = key;
+        first->length = 1 << 20;
+        first->state = slotSubmitted;
+        CHECK(waitFor([first]() { return first->state == slotFailed; }));
+        
+        slotHeader* second = slotAt(ring, 1, 16);
+        wcscpy(slotText(second), L"АБВ");
+        second->op = requestOp::encrypt;
+        second->keyId = key;
+        second->length = 3;
+        second->state = slotSubmitted;
+        CHECK(waitFor([second]() { return second->state == slotDone; }));
+        CHECK(wstring(slotText(second), 3) == modAlphaCipher(L"КЛЮЧ").encrypt(L"АБВ"));
+        munmap(ring, ringBytes(4, 16));
+    }
+}
+
+// ==================== ГЛАВНАЯ ФУНКЦИЯ ====================
+
+int main()
+{
+    wcout << L"==================================================" << endl;
+    wcout << L"МОДУЛЬНОЕ ТЕСТИРОВАНИЕ СЕРВИСА ШИФРОВАНИЯ" << endl;
+    wcout << L"==================================================" << endl << endl;
+
+    wcout << L"Выполняются тесты:" << endl;
+    wcout << L"1. ControlTest - 8 тестов" << endl;
+    wcout << L"2. RequestTest - 8 тестов" << endl;
+    wcout << L"Всего: 16 тестов" << endl << endl;
+
+    int result = UnitTest::RunAllTests();
+
+    wcout << endl << L"==================================================" << endl;
+    wcout << L"ТЕСТИРОВАНИЕ ЗАВЕРШЕНО" << endl;
+    wcout << L"==================================================" << endl;
+
+    return result;
+}
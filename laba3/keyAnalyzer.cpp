@@ -0,0 +1,257 @@
+#include "keyAnalyzer.h"
+#include <algorithm>
+#include <thread>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+// Частоты букв русского языка (%) в порядке алфавита шифра
+const double russianFreq[alphabetSize] = {
+    8.01, 1.59, 4.54, 1.70, 2.98, 8.45, 0.04, 0.94, 1.65, 7.35, 1.21,
+    3.49, 4.40, 3.21, 6.70, 10.97, 2.81, 4.73, 5.47, 6.26, 2.62, 0.26,
+    0.97, 0.48, 1.44, 0.73, 0.36, 0.04, 1.90, 1.74, 0.32, 0.64, 2.01
+};
+
+// Меньше этого числа букв на поток распараллеливание не окупается
+const size_t minChunk = 1 << 16;
+
+// Длина ключа оценивается по начальному фрагменту такой длины
+const size_t estimateSample = 1 << 20;
+
+// Число совпадающих байтов; при наличии SSE2 - по 16 байтов за шаг
+size_t countEqual(const unsigned char* a, const unsigned char* b, size_t len)
+{
+    size_t count = 0;
+    size_t i = 0;
+#if defined(__SSE2__)
+    while (len - i >= 16) {
+        // Байтовые счетчики сбрасываются в сумму не реже чем через 255 шагов
+        size_t steps = std::min((len - i) / 16, (size_t)255);
+        __m128i acc = _mm_setzero_si128();
+        for (size_t k = 0; k < steps; k++, i += 16) {
+            __m128i x = _mm_loadu_si128((const __m128i*)(a + i));
+            __m128i y = _mm_loadu_si128((const __m128i*)(b + i));
+            acc = _mm_sub_epi8(acc, _mm_cmpeq_epi8(x, y));
+        }
+        __m128i sums = _mm_sad_epu8(acc, _mm_setzero_si128());
+        count += _mm_cvtsi128_si32(sums) + _mm_extract_epi16(sums, 4);
+    }
+#endif
+    for (; i < len; i++) {
+        if (a[i] == b[i])
+            count++;
+    }
+    return count;
+}
+
+} // namespace
+
+keyAnalyzer::keyAnalyzer(const std::wstring& cipher_text)
+{
+    text = getValidCipherText(cipher_text);
+}
+
+// Валидация шифртекста и перевод букв в индексы алфавита
+std::vector<unsigned char> keyAnalyzer::getValidCipherText(const std::wstring& s)
+{
+    if (s.empty())
+        throw cipher_error("Empty cipher text");
+
+    std::vector<unsigned char> result(s.size());
+    size_t pos = toIndices(s.data(), s.size(), result.data());
+    if (pos != s.size()) {
+        throw cipher_error("Invalid cipher text - must contain only uppercase Russian letters (position "
+                           + std::to_string(pos) + ")");
+    }
+    return result;
+}
+
+// Гистограммы столбцов: элемент [col * 33 + letter].
+// Текст делится на части по потокам; внутри потока счетчики разнесены
+// по 4 банкам, чтобы соседние инкременты не ждали друг друга
+std::vector<size_t> keyAnalyzer::histograms(size_t period, size_t n)
+{
+    const size_t m = alphabetSize;
+    const size_t banks = 4;
+
+    size_t threads = std::thread::hardware_concurrency();
+    threads = std::max((size_t)1, std::min(threads, n / minChunk));
+
+    std::vector<std::vector<size_t>> partial(threads, std::vector<size_t>(banks * period * m, 0));
+    auto worker = [&](size_t t) {
+        size_t begin = n * t / threads;
+        size_t end = n * (t + 1) / threads;
+        size_t* local = partial[t].data();
+        size_t col = begin % period;
+        for (size_t i = begin; i < end; i++) {
+            local[((i % banks) * period + col) * m + text[i]]++;
+            if (++col == period)
+                col = 0;
+        }
+    };
+
+    std::vector<std::thread> pool;
+    for (size_t t = 1; t < threads; t++) {
+        pool.push_back(std::thread(worker, t));
+    }
+    worker(0);
+    for (auto& th : pool) {
+        th.join();
+    }
+
+    std::vector<size_t> result(period * m, 0);
+    for (auto& local : partial) {
+        for (size_t b = 0; b < banks; b++) {
+            for (size_t k = 0; k < period * m; k++) {
+                result[k] += local[b * period * m + k];
+            }
+        }
+    }
+    return result;
+}
+
+// Индекс совпадений одной гистограммы
+double keyAnalyzer::coincidence(const size_t* hist, size_t n)
+{
+    if (n < 2)
+        return 0;
+
+    double sum = 0;
+    for (size_t i = 0; i < alphabetSize; i++) {
+        sum += (double)hist[i] * ((double)hist[i] - 1);
+    }
+    return sum / ((double)n * (n - 1));
+}
+
+double keyAnalyzer::averageCoincidence(size_t period, size_t n)
+{
+    const size_t m = alphabetSize;
+    std::vector<size_t> hist = histograms(period, n);
+
+    double sum = 0;
+    for (size_t col = 0; col < period; col++) {
+        sum += coincidence(&hist[col * m], (n - col + period - 1) / period);
+    }
+    return sum / period;
+}
+
+double keyAnalyzer::indexOfCoincidence(size_t period)
+{
+    if (period == 0 || period > text.size())
+        throw cipher_error("Invalid period");
+    if (period > maxPeriod)
+        throw cipher_error("Period is too large");
+
+    return averageCoincidence(period, text.size());
+}
+
+std::vector<double> keyAnalyzer::autocorrelation(size_t maxShift)
+{
+    if (maxShift > 4 * maxPeriod)
+        throw cipher_error("Shift is too large");
+
+    std::vector<double> result(maxShift + 1, 0);
+    for (size_t shift = 1; shift <= maxShift && shift < text.size(); shift++) {
+        size_t len = std::min(text.size() - shift, estimateSample);
+        result[shift] = (double)countEqual(text.data(), text.data() + shift, len) / len;
+    }
+    return result;
+}
+
+// Наименьшая длина, показатель которой близок к лучшему: кратные истинной
+// длине ключа дают такой же показатель, остальные - заметно ниже
+size_t keyAnalyzer::chooseLength(const std::vector<double>& scores)
+{
+    const double random = 1.0 / alphabetSize;
+    double best = *std::max_element(scores.begin() + 1, scores.end());
+    double threshold = random + 0.75 * (best - random);
+
+    for (size_t len = 1; len < scores.size(); len++) {
+        if (scores[len] >= threshold)
+            return len;
+    }
+    return 1;
+}
+
+size_t keyAnalyzer::estimateKeyLength(size_t maxLength)
+{
+    if (maxLength == 0)
+        throw cipher_error("Invalid maximum key length");
+    if (maxLength > maxPeriod)
+        throw cipher_error("Maximum key length is too large");
+
+    size_t n = std::min(text.size(), estimateSample);
+    maxLength = std::min(maxLength, std::max((size_t)1, n / 2));
+    std::vector<double> scores(maxLength + 1, 0);
+    for (size_t len = 1; len <= maxLength; len++) {
+        scores[len] = averageCoincidence(len, n);
+    }
+    return chooseLength(scores);
+}
+
+// Метод Касиски: при сдвиге, кратном длине ключа, совпадений больше.
+// Для каждой длины усредняются не менее 4 кратных ей сдвигов
+size_t keyAnalyzer::autocorrelationKeyLength(size_t maxLength)
+{
+    if (maxLength == 0)
+        throw cipher_error("Invalid maximum key length");
+    if (maxLength > maxPeriod)
+        throw cipher_error("Maximum key length is too large");
+
+    maxLength = std::min(maxLength, std::max((size_t)1, text.size() / 8));
+    std::vector<double> shifts = autocorrelation(maxLength * 4);
+
+    std::vector<double> scores(maxLength + 1, 0);
+    for (size_t len = 1; len <= maxLength; len++) {
+        size_t count = 0;
+        for (size_t shift = len; shift < shifts.size(); shift += len, count++) {
+            scores[len] += shifts[shift];
+        }
+        scores[len] /= count;
+    }
+    return chooseLength(scores);
+}
+
+// Для каждого столбца выбирается сдвиг с наименьшим хи-квадрат
+// относительно частот русского языка
+std::wstring keyAnalyzer::recoverKey(size_t keyLength)
+{
+    if (keyLength == 0 || keyLength > text.size())
+        throw cipher_error("Invalid key length");
+    if (keyLength > maxPeriod)
+        throw cipher_error("Key length is too large");
+
+    const size_t m = alphabetSize;
+    std::vector<size_t> hist = histograms(keyLength, text.size());
+
+    std::wstring key;
+    for (size_t col = 0; col < keyLength; col++) {
+        const size_t* h = &hist[col * m];
+        double n = (text.size() - col + keyLength - 1) / keyLength;
+
+        size_t bestShift = 0;
+        double bestChi = -1;
+        for (size_t shift = 0; shift < m; shift++) {
+            double chi = 0;
+            for (size_t i = 0; i < m; i++) {
+                double expected = n * russianFreq[i] / 100;
+                double diff = h[(i + shift) % m] - expected;
+                chi += diff * diff / expected;
+            }
+            if (bestChi < 0 || chi < bestChi) {
+                bestChi = chi;
+                bestShift = shift;
+            }
+        }
+        key += indexLetter(bestShift);
+    }
+    return key;
+}
+
+std::wstring keyAnalyzer::recoverKey()
+{
+    return recoverKey(estimateKeyLength());
+}
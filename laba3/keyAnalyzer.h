@@ -0,0 +1,45 @@
+#pragma once
+#include <vector>
+#include <string>
+#include "modAlphaCipher.h"
+
+// Криптоанализ шифра Гронсфельда/Виженера для аудита стойкости ключей:
+// индекс совпадений, автокорреляция, восстановление ключа по частотам букв
+class keyAnalyzer
+{
+private:
+    std::vector<unsigned char> text;   // индексы букв шифртекста
+
+    std::vector<unsigned char> getValidCipherText(const std::wstring& s);
+
+    // Гистограммы букв каждого столбца по первым n буквам при заданном периоде
+    std::vector<size_t> histograms(size_t period, size_t n);
+    double averageCoincidence(size_t period, size_t n);
+    double coincidence(const size_t* hist, size_t n);
+    size_t chooseLength(const std::vector<double>& scores);
+
+public:
+    // Наибольший исследуемый период: память под гистограммы растет линейно с периодом
+    static const size_t maxPeriod = 256;
+    // Число букв шифртекста на символ ключа, начиная с которого recoverKey
+    // восстанавливает не меньше половины ключа (на русском тексте:
+    // 5 букв - 51% символов ключа, 10 - 76%, 30 - 99.8%)
+    static const size_t recoverableColumnLetters = 5;
+
+    keyAnalyzer() = delete;
+    keyAnalyzer(const std::wstring& cipher_text);
+
+    // Средний индекс совпадений столбцов при разбиении текста с периодом period
+    double indexOfCoincidence(size_t period = 1);
+    // Доля совпадающих букв при сдвиге текста на 1..maxShift (элемент 0 не используется),
+    // maxShift - не более 4 * maxPeriod
+    std::vector<double> autocorrelation(size_t maxShift);
+
+    // Оценки длины ключа по индексу совпадений и по автокорреляции
+    size_t estimateKeyLength(size_t maxLength = 32);
+    size_t autocorrelationKeyLength(size_t maxLength = 32);
+
+    // Восстановление ключа заданной длины по критерию хи-квадрат
+    std::wstring recoverKey(size_t keyLength);
+    std::wstring recoverKey();
+};
@@ -1,9 +1,12 @@
 #include <UnitTest++/UnitTest++.h>
 #include "modAlphaCipher.h"
+#include "keyAnalyzer.h"
 #include <locale>
 #include <iostream>
 #include <codecvt>
 #include <string>
+#include <thread>
+#include <vector>
 
 using namespace std;
 
@@ -70,6 +73,14 @@ SUITE(KeyTest)
         // 1.8 Вырожденный ключ
         CHECK_THROW(modAlphaCipher(L"ААА"), cipher_error);
     }
+    
+    TEST(LatinKey) {
+        // 1.9 Латинские буквы не входят в алфавит шифра
+        CHECK_THROW(modAlphaCipher(L"QWERTYUIOP"), cipher_error);
+        CHECK_THROW(modAlphaCipher(L"QWERTYUIOP", 40), cipher_error);
+        CHECK_THROW(modAlphaCipher(L"КЛЮЧkey"), cipher_error);
+        CHECK_EQUAL("ЁЁЁ", wstring_to_string(modAlphaCipher(L"ё").encrypt(L"ААА")));
+    }
 }
 
 // ==================== ТЕСТЫ ДЛЯ МЕТОДА ENCRYPT ====================
@@ -131,6 +142,13 @@ SUITE(EncryptTest)
         string actual = wstring_to_string(cipher.encrypt(L"АБВГДЕЁЖЗИЙКЛМНОПРСТУФХЦЧШЩЪЫЬЭЮЯ"));
         CHECK_EQUAL(expected, actual);
     }
+    
+    TEST_FIXTURE(KeyB_fixture, LongMixedString) {
+        // 2.8 Длинная строка: буквы разного регистра вперемешку с другими символами
+        string expected = "БВГДЕЁЖЗИЙКЛМНОПРСТУФХЦЧШЩЪЫЬЭЮЯАЖЖЁ";
+        string actual = wstring_to_string(p->encrypt(L"аБв1Гд  еЁЖз,,,,ИйкЛ12345678мНоп.рСтУфхцЧШщ ъЫьЭюЯ-Ёёеe"));
+        CHECK_EQUAL(expected, actual);
+    }
 }
 
 // ==================== ТЕСТЫ ДЛЯ МЕТОДА DECRYPT ====================
@@ -176,6 +194,288 @@ SUITE(DecryptTest)
         string actual = wstring_to_string(cipher.decrypt(L"ЯАБВГДЕЁЖЗИЙКЛМНОПРСТУФХЦЧШЩЪЫЬЭЮ"));
         CHECK_EQUAL(expected, actual);
     }
+    
+    TEST_FIXTURE(KeyB_fixture, InvalidPosition) {
+        // 3.8 В сообщении об ошибке указана позиция первого неверного символа
+        string what;
+        try {
+            p->decrypt(L"БВГДЕЁЖЗИЙКЛМaНОП");
+        } catch (const cipher_error& e) {
+            what = e.what();
+        }
+        CHECK(what.find("position 13") != string::npos);
+    }
+}
+
+// ==================== ТЕСТЫ ДЛЯ ПРЕОБРАЗОВАНИЯ "НА МЕСТЕ" ====================
+
+SUITE(InPlaceTest)
+{
+    TEST(EncryptInPlace) {
+        // 4.1 Шифрование буфера без копирования
+        wstring text = L"ААААА";
+        modAlphaCipher(L"БВГ").encryptInPlace(text);
+        CHECK_EQUAL("БВГБВ", wstring_to_string(text));
+    }
+    
+    TEST(DecryptInPlace) {
+        // 4.2 Расшифрование буфера без копирования
+        wstring text = L"ЯАБВГДЕЁЖЗИЙКЛМНОПРСТУФХЦЧШЩЪЫЬЭЮ";
+        modAlphaCipher(L"Я").decryptInPlace(text);
+        CHECK_EQUAL("АБВГДЕЁЖЗИЙКЛМНОПРСТУФХЦЧШЩЪЫЬЭЮЯ", wstring_to_string(text));
+    }
+    
+    TEST(MatchesEncrypt) {
+        // 4.3 Результат совпадает с encrypt
+        modAlphaCipher cipher(L"КЛЮЧ");
+        wstring text = L"ПРОГРАММИРОВАНИЕЁЖИК";
+        wstring expected = cipher.encrypt(text);
+        cipher.encryptInPlace(&text[0], text.size());
+        CHECK_EQUAL(wstring_to_string(expected), wstring_to_string(text));
+        cipher.decryptInPlace(&text[0], text.size());
+        CHECK_EQUAL("ПРОГРАММИРОВАНИЕЁЖИК", wstring_to_string(text));
+    }
+    
+    TEST(NotNormalizedText) {
+        // 4.4 Ненормализованный текст отвергается, буфер не изменяется
+        wstring text = L"АБВ где";
+        CHECK_THROW(modAlphaCipher(L"Б").encryptInPlace(text), cipher_error);
+        CHECK_EQUAL("АБВ где", wstring_to_string(text));
+    }
+    
+    TEST(EmptyText) {
+        // 4.5 Пустой буфер
+        wstring text;
+        CHECK_THROW(modAlphaCipher(L"Б").decryptInPlace(text), cipher_error);
+    }
+    
+    TEST(SharedCipher) {
+        // 4.6 Один шифр используется несколькими потоками одновременно
+        modAlphaCipher cipher(L"КЛЮЧ");
+        wstring expected = cipher.encrypt(wstring(10000, L'Ж'));
+        vector<wstring> texts(4, wstring(10000, L'Ж'));
+        vector<thread> pool;
+        for (auto& text : texts) {
+            pool.push_back(thread([&cipher, &text]() {
+                for (int i = 0; i < 20; i++) {
+                    cipher.encryptInPlace(text);
+                    cipher.decryptInPlace(text);
+                }
+                cipher.encryptInPlace(text);
+            }));
+        }
+        for (auto& th : pool) {
+            th.join();
+        }
+        for (auto& text : texts) {
+            CHECK(text == expected);
+        }
+    }
+}
+
+// ==================== ТЕСТЫ ДЛЯ ПРОИЗВОЛЬНОГО ДОСТУПА ====================
+
+SUITE(RangeTest)
+{
+    TEST(DecryptRange) {
+        // 5.1 Фрагмент из середины расшифровывается с правильной фазой ключа
+        modAlphaCipher cipher(L"КЛЮЧ");
+        wstring encrypted = cipher.encrypt(L"ПРОГРАММИРОВАНИЕ");
+        CHECK_EQUAL("РАММИР", wstring_to_string(cipher.decryptRange(encrypted, 4, 6)));
+    }
+    
+    TEST(IndexedRecord) {
+        // 5.2 Запись находится по индексу позиции в открытом тексте
+        modAlphaCipher cipher(L"ШИФР");
+        wstring open_text = L"Раз, два. Три; четыре! Пять, шесть: семь, восемь.";
+        LetterIndex index;
+        wstring encrypted = cipher.encrypt(open_text, index, 15);
+        CHECK_EQUAL(4u, index.letters.size());
+        
+        // Блок 1 начинается со слова "четыре", перед ним 9 букв
+        size_t offset = index.letterOffset(24);
+        CHECK_EQUAL(9u, offset);
+        CHECK_EQUAL("ЧЕТЫРЕ", wstring_to_string(cipher.decryptRange(encrypted, offset, 6)));
+    }
+    
+    TEST(OutOfRange) {
+        // 5.3 Выход за пределы шифртекста и индекса
+        modAlphaCipher cipher(L"БВГ");
+        LetterIndex index;
+        wstring encrypted = cipher.encrypt(L"АБВГД", index);
+        CHECK_THROW(cipher.decryptRange(encrypted, 3, 3), cipher_error);
+        CHECK_THROW(index.letterOffset(5000), cipher_error);
+    }
+    
+    TEST(ZeroBlockSize) {
+        // 5.4 Нулевой размер блока индекса
+        LetterIndex index;
+        CHECK_THROW(modAlphaCipher(L"БВГ").encrypt(L"АБВГД", index, 0), cipher_error);
+    }
+    
+    TEST(SavedIndex) {
+        // 5.5 Индекс сохраняется и читается отдельно от шифрования
+        modAlphaCipher cipher(L"ШИФР");
+        LetterIndex index;
+        cipher.encrypt(L"Раз, два. Три; четыре! Пять, шесть: семь, восемь.", index, 15);
+        string bytes = index.toBytes();
+        CHECK_EQUAL(20u + 4 * 8, bytes.size());
+        
+        LetterIndex loaded = LetterIndex::fromBytes(bytes);
+        CHECK_EQUAL(15u, loaded.blockSize);
+        CHECK(loaded.letters == index.letters);
+        
+        CHECK_THROW(LetterIndex::fromBytes(bytes.substr(0, bytes.size() - 1)), cipher_error);
+        bytes[4] = 0;
+        CHECK_THROW(LetterIndex::fromBytes(bytes), cipher_error);
+        CHECK_THROW(LetterIndex::fromBytes("LIX2"), cipher_error);
+    }
+    
+    TEST(DecryptSlice) {
+        // 5.6 Расшифровывается только прочитанный фрагмент шифртекста
+        modAlphaCipher cipher(L"КЛЮЧ");
+        wstring encrypted = cipher.encrypt(L"ПРОГРАММИРОВАНИЕ");
+        wstring slice = encrypted.substr(4, 6);
+        CHECK_EQUAL("РАММИР", wstring_to_string(cipher.decryptRange(slice.data(), 4, slice.size())));
+    }
+    
+    TEST(EmptyRange) {
+        // 5.7 Пустой диапазон дает пустую строку
+        modAlphaCipher cipher(L"КЛЮЧ");
+        wstring encrypted = cipher.encrypt(L"ПРОГРАММИРОВАНИЕ");
+        CHECK(cipher.decryptRange(encrypted, 16, 0).empty());
+        CHECK(cipher.decryptRange(nullptr, 0, 0).empty());
+        CHECK_THROW(cipher.decryptRange(encrypted, 17, 0), cipher_error);
+    }
+}
+
+// ==================== ТЕСТЫ ДЛЯ КРИПТОАНАЛИЗА КЛЮЧЕЙ ====================
+
+const wchar_t* sampleText =
+    L"Ранним утром город медленно просыпался. По широким улицам проезжали первые трамваи, "
+    L"дворники сметали с тротуаров опавшие листья, а в окнах домов один за другим загорались огни. "
+    L"На центральной площади открывались небольшие магазины и кофейни, и запах свежего хлеба разносился "
+    L"далеко вокруг. Старый учитель истории, как всегда, вышел из дома ровно в семь часов и неторопливо "
+    L"направился к школе. Он любил эти утренние прогулки, когда можно спокойно подумать о предстоящих уроках "
+    L"и вспомнить прочитанные накануне книги. Ученики уважали его за справедливость и за умение рассказывать "
+    L"о прошлом так, будто он сам был свидетелем великих событий. В тот день он собирался говорить о путешествиях "
+    L"первых мореплавателей, которые отправлялись в неизвестность, не зная, вернутся ли они домой. Погода "
+    L"обещала быть ясной, ветер стих, и над рекой поднимался легкий туман. На мосту остановились рыбаки, "
+    L"они терпеливо ждали удачи и обсуждали последние новости. Жизнь шла своим чередом, спокойно и размеренно, "
+    L"и никто не подозревал, что этот обычный день запомнится надолго.";
+
+SUITE(AnalysisTest)
+{
+    TEST(IndexOfCoincidence) {
+        // 6.1 Индекс совпадений русского текста не зависит от сдвига
+        keyAnalyzer analyzer(modAlphaCipher(L"В").encrypt(sampleText));
+        double ic = analyzer.indexOfCoincidence();
+        CHECK(ic > 0.05 && ic < 0.065);
+    }
+    
+    TEST(KeyLength) {
+        // 6.2 Длина ключа по индексу совпадений и по автокорреляции
+        keyAnalyzer analyzer(modAlphaCipher(L"ЛИМОН").encrypt(sampleText));
+        CHECK_EQUAL(5u, analyzer.estimateKeyLength());
+        CHECK_EQUAL(5u, analyzer.autocorrelationKeyLength());
+    }
+    
+    TEST(RecoverKey) {
+        // 6.3 Восстановление короткого ключа
+        keyAnalyzer analyzer(modAlphaCipher(L"ЛИМОН").encrypt(sampleText));
+        CHECK_EQUAL("ЛИМОН", wstring_to_string(analyzer.recoverKey()));
+    }
+    
+    TEST(InvalidCipherText) {
+        // 6.4 Неверный шифртекст
+        CHECK_THROW(keyAnalyzer(L""), cipher_error);
+        CHECK_THROW(keyAnalyzer(L"АБВ ГДЕ"), cipher_error);
+    }
+    
+    TEST(LargePeriod) {
+        // 6.5 Период больше keyAnalyzer::maxPeriod отвергается до выделения памяти
+        keyAnalyzer analyzer(modAlphaCipher(L"ЛИМОН").encrypt(wstring(1000, L'А')));
+        size_t tooLarge = keyAnalyzer::maxPeriod + 1;
+        CHECK_THROW(analyzer.indexOfCoincidence(tooLarge), cipher_error);
+        CHECK_THROW(analyzer.recoverKey(tooLarge), cipher_error);
+        CHECK_THROW(analyzer.estimateKeyLength(tooLarge), cipher_error);
+        CHECK_THROW(analyzer.autocorrelation(4 * tooLarge), cipher_error);
+        CHECK_EQUAL(5u, analyzer.recoverKey(5).size());
+    }
+    
+    TEST(StrongKey) {
+        // 6.6 Отвергаются ключи, восстанавливаемые по шифртексту ожидаемой длины
+        CHECK_THROW(modAlphaCipher(L"ЛИМОН", 100), cipher_error);
+        CHECK_THROW(modAlphaCipher(L"ЛИМОНЛИМОНЛИМОН", 30), cipher_error);
+        CHECK_EQUAL("ОДПРОДЙС", wstring_to_string(modAlphaCipher(L"ПЕРСПЕКТИВА", 50).encrypt(L"ЯЯЯЯЯЯЯЯ")));
+        CHECK_THROW(modAlphaCipher(L"ПЕРСПЕКТИВА", 55), cipher_error);
+        
+        // Отвергнутый ключ действительно восстанавливается по такому шифртексту
+        wstring encrypted = modAlphaCipher(L"ЛИМОН").encrypt(sampleText);
+        CHECK_EQUAL("ЛИМОН", wstring_to_string(keyAnalyzer(encrypted.substr(0, 500)).recoverKey(5)));
+    }
+}
+
+// ==================== ТЕСТЫ ДЛЯ УПАКОВАННОГО ФОРМАТА ====================
+
+SUITE(PackedTest)
+{
+    TEST(RoundTrip) {
+        // 7.1 Упаковка и распаковка строк разной длины
+        wstring alphabet = L"АБВГДЕЁЖЗИЙКЛМНОПРСТУФХЦЧШЩЪЫЬЭЮЯ";
+        bool ok = true;
+        for (size_t len = 1; len <= alphabet.size(); len++) {
+            wstring text = alphabet.substr(alphabet.size() - len) + alphabet.substr(0, len);
+            packedText packed(packedText(text, cipherType::gronsfeld).toBytes());
+            ok = ok && packed.unpack() == text;
+        }
+        CHECK(ok);
+    }
+    
+    TEST(Size) {
+        // 7.2 4 буквы занимают 3 байта, заголовок - 20 байт
+        packedText packed(wstring(1000, L'Ж'), cipherType::gronsfeld);
+        CHECK_EQUAL(770u, packed.toBytes().size());
+    }
+    
+    TEST(DecryptPacked) {
+        // 7.3 Расшифрование упакованного текста совпадает с обычным
+        modAlphaCipher cipher(L"КЛЮЧ");
+        wstring encrypted = cipher.encrypt(sampleText);
+        packedText packed(packedText(encrypted, cipherType::gronsfeld).toBytes());
+        CHECK_EQUAL(wstring_to_string(cipher.decrypt(encrypted)), wstring_to_string(cipher.decrypt(packed)));
+    }
+    
+    TEST(InvalidText) {
+        // 7.4 Упаковываются только прописные буквы
+        CHECK_THROW(packedText(L"", cipherType::gronsfeld), packed_text_error);
+        CHECK_THROW(packedText(L"АБВГДЕЁЖЗИЙКЛМНОПРСТУФХЦЧШЩЪЫЬЭЮЯ ", cipherType::gronsfeld), packed_text_error);
+    }
+    
+    TEST(Corrupted) {
+        // 7.5 Поврежденные данные и заголовок
+        string bytes = packedText(L"АБВГДЕЁЖ", cipherType::gronsfeld).toBytes();
+        string damaged = bytes;
+        damaged[damaged.size() - 1] ^= 1;
+        CHECK_THROW(packedText{damaged}, packed_text_error);
+        CHECK_THROW(packedText{bytes.substr(0, bytes.size() - 1)}, packed_text_error);
+        CHECK_THROW(packedText{string("XPK6") + bytes.substr(4)}, packed_text_error);
+        
+        // Заголовок тоже входит в контрольную сумму
+        damaged = bytes;
+        damaged[5] = (char)cipherType::route;
+        CHECK_THROW(packedText{damaged}, packed_text_error);
+        damaged = bytes;
+        damaged[8] = 7;
+        CHECK_THROW(packedText{damaged}, packed_text_error);
+        CHECK_THROW(packedText(L"АБВ", (cipherType)3), packed_text_error);
+    }
+    
+    TEST(WrongCipher) {
+        // 7.6 Текст другого шифра
+        packedText packed(L"АБВГД", cipherType::route);
+        CHECK_THROW(modAlphaCipher(L"БВГ").decrypt(packed), cipher_error);
+    }
 }
 
 // ==================== ГЛАВНАЯ ФУНКЦИЯ ====================
@@ -190,10 +490,14 @@ int main()
     std::wcout << L"==================================================" << std::endl << std::endl;
     
     std::wcout << L"Выполняются тесты:" << std::endl;
-    std::wcout << L"1. KeyTest - 8 тестов" << std::endl;
-    std::wcout << L"2. EncryptTest - 7 тестов" << std::endl;
-    std::wcout << L"3. DecryptTest - 7 тестов" << std::endl;
-    std::wcout << L"Всего: 22 теста" << std::endl << std::endl;
+    std::wcout << L"1. KeyTest - 9 тестов" << std::endl;
+    std::wcout << L"2. EncryptTest - 8 тестов" << std::endl;
+    std::wcout << L"3. DecryptTest - 8 тестов" << std::endl;
+    std::wcout << L"4. InPlaceTest - 6 тестов" << std::endl;
+    std::wcout << L"5. RangeTest - 7 тестов" << std::endl;
+    std::wcout << L"6. AnalysisTest - 6 тестов" << std::endl;
+    std::wcout << L"7. PackedTest - 6 тестов" << std::endl;
+    std::wcout << L"Всего: 50 тестов" << std::endl << std::endl;
     
     int result = UnitTest::RunAllTests();
     
@@ -1,13 +1,106 @@
 #include "modAlphaCipher.h"
+#include "russianAlphabet.h"
+#include "keyAnalyzer.h"
 #include <locale>
 #include <codecvt>
 #include <algorithm>
 #include <cwctype>
+#include <cstdint>
 
-std::locale loc("ru_RU.UTF-8");
+namespace {
+
+// Количество букв алфавита (любого регистра)
+size_t countLetters(const wchar_t* s, size_t len)
+{
+    size_t n = 0;
+    for (size_t i = 0; i < len; i++) {
+        if (isUpperLetter(s[i]) || isLowerLetter(s[i]))
+            n++;
+    }
+    return n;
+}
+
+const char indexMagic[4] = {'L', 'I', 'X', '1'};
+const size_t indexHeaderSize = 20;
+
+void putU64(std::string& out, uint64_t value)
+{
+    for (int i = 0; i < 8; i++) {
+        out.push_back((char)(value >> (8 * i)));
+    }
+}
+
+uint64_t getU64(const std::string& in, size_t pos)
+{
+    uint64_t value = 0;
+    for (int i = 0; i < 8; i++) {
+        value |= (uint64_t)(unsigned char)in[pos + i] << (8 * i);
+    }
+    return value;
+}
+
+// Период ключа: наименьшая длина, повторением которой получается ключ
+size_t keyPeriod(const std::vector<int>& key)
+{
+    for (size_t p = 1; p < key.size(); p++) {
+        if (key.size() % p != 0)
+            continue;
+        bool repeats = true;
+        for (size_t i = p; i < key.size() && repeats; i++) {
+            repeats = key[i] == key[i - p];
+        }
+        if (repeats)
+            return p;
+    }
+    return key.size();
+}
+
+} // namespace
+
+// Позиция в шифртексте начала блока, содержащего символ offset
+size_t LetterIndex::letterOffset(size_t offset) const
+{
+    size_t block = offset / blockSize;
+    if (block >= letters.size())
+        throw cipher_error("Offset is out of indexed range");
+    return letters[block];
+}
+
+std::string LetterIndex::toBytes() const
+{
+    std::string out(indexMagic, 4);
+    putU64(out, blockSize);
+    putU64(out, letters.size());
+    for (size_t count : letters) {
+        putU64(out, count);
+    }
+    return out;
+}
+
+// Смещения блоков не убывают, а первый блок начинается с нулевой буквы
+LetterIndex LetterIndex::fromBytes(const std::string& bytes)
+{
+    if (bytes.size() < indexHeaderSize || bytes.compare(0, 4, indexMagic, 4) != 0)
+        throw cipher_error("Not a letter index");
+    
+    LetterIndex index;
+    index.blockSize = getU64(bytes, 4);
+    uint64_t blocks = getU64(bytes, 12);
+    if (index.blockSize == 0 || blocks > (bytes.size() - indexHeaderSize) / 8
+        || bytes.size() != indexHeaderSize + blocks * 8)
+        throw cipher_error("Invalid letter index size");
+    
+    index.letters.resize(blocks);
+    for (size_t b = 0; b < blocks; b++) {
+        index.letters[b] = getU64(bytes, indexHeaderSize + b * 8);
+        if (b == 0 ? index.letters[b] != 0 : index.letters[b] < index.letters[b - 1])
+            throw cipher_error("Invalid letter index offsets");
+    }
+    return index;
+}
 
 // Конструктор с валидацией ключа
-modAlphaCipher::modAlphaCipher(const std::wstring& skey)
+modAlphaCipher::modAlphaCipher(const std::wstring& skey, size_t textLength)
 {
     // Инициализация алфавита
     for (size_t i = 0; i < numAlpha.size(); i++) {
@@ -15,23 +108,23 @@ modAlphaCipher::modAlphaCipher(const std::wstring& skey)
     }
     
     // Валидация и установка ключа
-    key = convert(getValidKey(skey));
+    key = convert(getValidKey(skey, textLength));
 }
 
 // Валидация ключа
-std::wstring modAlphaCipher::getValidKey(const std::wstring& s)
+std::wstring modAlphaCipher::getValidKey(const std::wstring& s, size_t textLength)
 {
     if (s.empty())
         throw cipher_error("Empty key");
     
+    // Допускаются только буквы алфавита шифра: буквы других алфавитов
+    // не имеют индекса и дали бы нулевой сдвиг
     std::wstring tmp(s);
     for (auto& c : tmp) {
-        if (!isalpha(c, loc)) {
+        c = toUpperLetter(c);
+        if (letterIndex(c) < 0) {
             throw cipher_error("Invalid key character");
         }
-        if (islower(c, loc)) {
-            c = toupper(c, loc);
-        }
     }
     
     // Проверка на вырожденный ключ (только для ключей длиной > 1)
@@ -48,22 +141,21 @@ std::wstring modAlphaCipher::getValidKey(const std::wstring& s)
         }
     }
     
+    // Каждый символ ключа сдвигает textLength / период букв шифртекста;
+    // начиная с recoverableColumnLetters букв keyAnalyzer восстанавливает его по частотам
+    if (textLength > 0 && textLength / keyPeriod(convert(tmp)) >= keyAnalyzer::recoverableColumnLetters) {
+        throw cipher_error("Weak key - recoverable from cipher text of expected length");
+    }
+    
     return tmp;
 }
 
 // Валидация открытого текста
 std::wstring modAlphaCipher::getValidOpenText(const std::wstring& s)
 {
-    std::wstring tmp;
-    for (auto c : s) {
-        if (isalpha(c, loc)) {
-            if (islower(c, loc))
-                tmp.push_back(toupper(c, loc));
-            else
-                tmp.push_back(c);
-        }
-        // Игнорируем пробелы и другие символы
-    }
+    // Пробелы и другие символы отбрасываются, строчные буквы переводятся в прописные
+    std::wstring tmp(s.size(), L'\0');
+    tmp.resize(compactLetters(s.data(), s.size(), &tmp[0]));
     
     if (tmp.empty())
         throw cipher_error("Empty open text after removing non-alphabetic characters");
@@ -77,14 +169,27 @@ std::wstring modAlphaCipher::getValidCipherText(const std::wstring& s)
     if (s.empty())
         throw cipher_error("Empty cipher text");
     
-    for (auto c : s) {
-        if (!isupper(c, loc)) {
-            throw cipher_error("Invalid cipher text - must contain only uppercase Russian letters");
-        }
+    size_t pos = findInvalidUpper(s.data(), s.size());
+    if (pos != s.size()) {
+        throw cipher_error("Invalid cipher text - must contain only uppercase Russian letters (position "
+                           + std::to_string(pos) + ")");
     }
     return s;
 }
 
+// Проверка нормализованного текста для преобразования "на месте"
+void modAlphaCipher::checkNormalizedText(const wchar_t* text, size_t len)
+{
+    if (len == 0)
+        throw cipher_error("Empty text");
+    
+    size_t pos = findInvalidUpper(text, len);
+    if (pos != len) {
+        throw cipher_error("Invalid text - must contain only uppercase Russian letters (position "
+                           + std::to_string(pos) + ")");
+    }
+}
+
 // Шифрование
 std::wstring modAlphaCipher::encrypt(const std::wstring& open_text)
 {
@@ -109,6 +214,115 @@ std::wstring modAlphaCipher::decrypt(const std::wstring& cipher_text)
     return convert(work);
 }
 
+// Расшифрование упакованного текста: индексы букв распаковываются блоками
+// и сразу сдвигаются, шифртекст в виде строки не создается
+std::wstring modAlphaCipher::decrypt(const packedText& packed)
+{
+    if (packed.getType() != cipherType::gronsfeld)
+        throw cipher_error("Packed text was produced by another cipher");
+    
+    const size_t block = 4096;
+    const int n = numAlpha.size();
+    std::wstring result(packed.size(), L'\0');
+    unsigned char idx[block];
+    size_t k = 0;
+    for (size_t pos = 0; pos < packed.size(); pos += block) {
+        size_t count = std::min(block, packed.size() - pos);
+        packed.unpackIndices(pos, count, idx);
+        for (size_t i = 0; i < count; i++) {
+            result[pos + i] = numAlpha[(idx[i] + n - key[k]) % n];
+            if (++k == key.size())
+                k = 0;
+        }
+    }
+    return result;
+}
+
+// Шифрование с построением индекса букв
+std::wstring modAlphaCipher::encrypt(const std::wstring& open_text, LetterIndex& index, size_t blockSize)
+{
+    if (blockSize == 0)
+        throw cipher_error("Index block size must be positive");
+    
+    std::wstring result = encrypt(open_text);
+    
+    index.blockSize = blockSize;
+    index.letters.clear();
+    size_t count = 0;
+    for (size_t pos = 0; pos < open_text.size(); pos += blockSize) {
+        index.letters.push_back(count);
+        count += countLetters(open_text.data() + pos, std::min(blockSize, open_text.size() - pos));
+    }
+    
+    return result;
+}
+
+// Расшифрование фрагмента: фаза ключа определяется позицией первой буквы,
+// проверяется и копируется только сам фрагмент
+std::wstring modAlphaCipher::decryptRange(const std::wstring& cipher_text, size_t offset, size_t length)
+{
+    if (offset > cipher_text.size() || length > cipher_text.size() - offset)
+        throw cipher_error("Range is out of cipher text");
+    
+    return decryptRange(cipher_text.data() + offset, offset, length);
+}
+
+// Расшифрование отдельно прочитанного фрагмента: фаза ключа берется из offset
+std::wstring modAlphaCipher::decryptRange(const wchar_t* slice, size_t offset, size_t length)
+{
+    if (length == 0)
+        return std::wstring();
+    if (slice == nullptr)
+        throw cipher_error("Empty cipher text fragment");
+    
+    std::wstring result(slice, length);
+    transformInPlace(&result[0], length, true, offset);
+    return result;
+}
+
+// Сдвиг каждой буквы буфера на соответствующую букву ключа.
+// Буфер проверяется целиком до изменения, поэтому при ошибке он остается нетронутым.
+// Объект при этом только читается, поэтому один шифр можно вызывать из разных потоков
+void modAlphaCipher::transformInPlace(wchar_t* text, size_t len, bool inverse, size_t phase)
+{
+    checkNormalizedText(text, len);
+    
+    const int n = numAlpha.size();
+    size_t k = phase % key.size();
+    for (size_t i = 0; i < len; i++) {
+        // Буфер мог измениться после проверки (например, в разделяемой памяти)
+        int idx = letterIndex(text[i]);
+        if (idx < 0)
+            throw cipher_error("Text changed during transformation (position " + std::to_string(i) + ")");
+        int shift = inverse ? n - key[k] : key[k];
+        text[i] = numAlpha[(idx + shift) % n];
+        if (++k == key.size())
+            k = 0;
+    }
+}
+
+// Шифрование "на месте"
+void modAlphaCipher::encryptInPlace(wchar_t* text, size_t len)
+{
+    transformInPlace(text, len, false);
+}
+
+// Расшифрование "на месте"
+void modAlphaCipher::decryptInPlace(wchar_t* text, size_t len)
+{
+    transformInPlace(text, len, true);
+}
+
+void modAlphaCipher::encryptInPlace(std::wstring& text)
+{
+    transformInPlace(&text[0], text.size(), false);
+}
+
+void modAlphaCipher::decryptInPlace(std::wstring& text)
+{
+    transformInPlace(&text[0], text.size(), true);
+}
+
 // Преобразование строки в вектор чисел
 std::vector<int> modAlphaCipher::convert(const std::wstring& s)
 {
@@ -117,8 +331,9 @@ std::vector<int> modAlphaCipher::convert(const std::wstring& s)
         if (c == L' ') {
             continue;
         }
-        if (alphaNum.find(c) != alphaNum.end()) {
-            result.push_back(alphaNum[c]);
+        auto it = alphaNum.find(c);
+        if (it != alphaNum.end()) {
+            result.push_back(it->second);
         } else {
             // В этом месте не должно быть невалидных символов
             result.push_back(0);
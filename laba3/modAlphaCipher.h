@@ -5,6 +5,8 @@
 #include <locale>
 #include <stdexcept>
 #include <algorithm>
+#include "packedText.h"
+#include "russianAlphabet.h"
 
 class cipher_error : public std::invalid_argument {
 public:
@@ -14,10 +16,27 @@ public:
         std::invalid_argument(what_arg) {}
 };
 
+// Разреженный индекс открытого текста для произвольного доступа к шифртексту:
+// letters[b] - число букв перед символом b * blockSize открытого текста.
+// Индекс хранится в отдельном файле рядом с шифртекстом
+struct LetterIndex {
+    size_t blockSize = 4096;
+    std::vector<size_t> letters;
+
+    // Позиция в шифртексте начала блока, содержащего символ offset открытого текста
+    size_t letterOffset(size_t offset) const;
+
+    // Формат (целые числа - 8 байт, little-endian):
+    // "LIX1", blockSize, число блоков, letters
+    std::string toBytes() const;
+    // Чтение с проверкой формата
+    static LetterIndex fromBytes(const std::string& bytes);
+};
+
 class modAlphaCipher
 {
 private:
-    std::wstring numAlpha = L"АБВГДЕЁЖЗИЙКЛМНОПРСТУФХЦЧШЩЪЫЬЭЮЯ";
+    std::wstring numAlpha = russianLetters;
     std::map<wchar_t, int> alphaNum;
     std::vector<int> key;
 
@@ -25,14 +44,37 @@ private:
     std::wstring convert(const std::vector<int>& v);
     
     // Методы валидации
-    std::wstring getValidKey(const std::wstring& s);
+    std::wstring getValidKey(const std::wstring& s, size_t textLength = 0);
     std::wstring getValidOpenText(const std::wstring& s);
     std::wstring getValidCipherText(const std::wstring& s);
+    void checkNormalizedText(const wchar_t* text, size_t len);
+
+    // Преобразование "на месте"
+    void transformInPlace(wchar_t* text, size_t len, bool inverse, size_t phase = 0);
 
 public:
     modAlphaCipher() = delete;
-    modAlphaCipher(const std::wstring& skey);
+    // textLength - ожидаемый объем шифруемого текста (0 - без проверки):
+    // отвергаются ключи, которые keyAnalyzer восстановит по такому шифртексту
+    modAlphaCipher(const std::wstring& skey, size_t textLength = 0);
     
     std::wstring encrypt(const std::wstring& open_text);
     std::wstring decrypt(const std::wstring& cipher_text);
+    // Расшифрование упакованного шифртекста без распаковки в строку
+    std::wstring decrypt(const packedText& packed);
+
+    // Шифрование с построением индекса через каждые blockSize символов открытого текста
+    std::wstring encrypt(const std::wstring& open_text, LetterIndex& index, size_t blockSize = 4096);
+    // Расшифрование length букв шифртекста начиная с буквы offset
+    std::wstring decryptRange(const std::wstring& cipher_text, size_t offset, size_t length);
+    // То же для фрагмента, прочитанного отдельно: slice - буквы шифртекста
+    // с номерами [offset, offset + length), остальной шифртекст не нужен
+    std::wstring decryptRange(const wchar_t* slice, size_t offset, size_t length);
+
+    // Шифрование и расшифрование без копирования буфера.
+    // Текст должен быть уже нормализован (только прописные буквы алфавита)
+    void encryptInPlace(wchar_t* text, size_t len);
+    void decryptInPlace(wchar_t* text, size_t len);
+    void encryptInPlace(std::wstring& text);
+    void decryptInPlace(std::wstring& text);
 };
\ No newline at end of file
@@ -0,0 +1,259 @@
+#include "packedText.h"
+#include <algorithm>
+#include <cstring>
+#include <cstdint>
+#include <cwchar>
+
+#if defined(__SSE2__) && WCHAR_MAX > 0xFFFF
+#include <emmintrin.h>
+#define PACKED_TEXT_SIMD 1
+#else
+#define PACKED_TEXT_SIMD 0
+#endif
+
+namespace {
+
+const char magic[4] = {'C', 'P', 'K', '6'};
+const unsigned char formatVersion = 1;
+const unsigned char russianAlphabet = 1;
+const unsigned char flagChecksum = 1;
+const size_t headerSize = 20;
+
+// Буквы обрабатываются блоками такой длины (кратной 16)
+const size_t chunk = 4096;
+
+// Размер упакованных данных: 4 буквы в 3 байтах
+size_t packedSize(size_t letters)
+{
+    return (letters + 3) / 4 * 3;
+}
+
+void putLE(std::string& out, uint64_t value, int bytes)
+{
+    for (int i = 0; i < bytes; i++) {
+        out.push_back((char)(value >> (8 * i)));
+    }
+}
+
+uint64_t getLE(const std::string& in, size_t pos, int bytes)
+{
+    uint64_t value = 0;
+    for (int i = 0; i < bytes; i++) {
+        value |= (uint64_t)(unsigned char)in[pos + i] << (8 * i);
+    }
+    return value;
+}
+
+uint32_t fnv1a(const char* p, size_t n, uint32_t h = 2166136261u)
+{
+    for (size_t i = 0; i < n; i++) {
+        h ^= (unsigned char)p[i];
+        h *= 16777619u;
+    }
+    return h;
+}
+
+// Контрольная сумма покрывает заголовок до поля суммы и данные
+uint32_t checksum(const char* header, const std::string& data)
+{
+    return fnv1a(data.data(), data.size(), fnv1a(header, 16));
+}
+
+bool knownType(cipherType ctype)
+{
+    return ctype == cipherType::gronsfeld || ctype == cipherType::route;
+}
+
+// Упаковка групп по 4 индекса: a | b << 6 | c << 12 | d << 18 в 3 байта
+void packGroups(const unsigned char* idx, size_t groups, unsigned char* out)
+{
+    size_t g = 0;
+#if PACKED_TEXT_SIMD
+    // 16 индексов дают 12 байт, записываются все 16: лишние 4 байта перезаписывает
+    // следующий шаг, поэтому после шага должно оставаться не меньше 2 групп
+    const __m128i low24 = _mm_set1_epi64x(0x0000000000FFFFFFLL);
+    const __m128i high24 = _mm_set1_epi64x(0x00FFFFFF00000000LL);
+    const __m128i lowHalf = _mm_set_epi64x(0, -1);
+    for (; g + 6 <= groups; g += 4) {
+        // В каждом 32-битном элементе - байты a, b, c, d одной группы
+        __m128i x = _mm_loadu_si128((const __m128i*)(idx + 4 * g));
+        __m128i v = _mm_and_si128(x, _mm_set1_epi32(0x000000FF));
+        v = _mm_or_si128(v, _mm_srli_epi32(_mm_and_si128(x, _mm_set1_epi32(0x0000FF00)), 2));
+        v = _mm_or_si128(v, _mm_srli_epi32(_mm_and_si128(x, _mm_set1_epi32(0x00FF0000)), 4));
+        v = _mm_or_si128(v, _mm_srli_epi32(_mm_and_si128(x, _mm_set1_epi32((int)0xFF000000)), 6));
+        // Две 24-битные группы каждой 64-битной половины - в ее младшие 6 байт,
+        // затем старшая половина сдвигается вплотную к младшей
+        v = _mm_or_si128(_mm_and_si128(v, low24), _mm_srli_epi64(_mm_and_si128(v, high24), 8));
+        v = _mm_or_si128(_mm_and_si128(v, lowHalf), _mm_srli_si128(_mm_andnot_si128(lowHalf, v), 2));
+        _mm_storeu_si128((__m128i*)(out + 3 * g), v);
+    }
+#endif
+    for (; g < groups; g++) {
+        const unsigned char* p = idx + 4 * g;
+        uint32_t v = p[0] | p[1] << 6 | p[2] << 12 | (uint32_t)p[3] << 18;
+        out[3 * g] = v;
+        out[3 * g + 1] = v >> 8;
+        out[3 * g + 2] = v >> 16;
+    }
+}
+
+// Распаковка групп: 3 байта в 4 индекса
+void unpackGroups(const unsigned char* in, size_t groups, unsigned char* idx)
+{
+    size_t g = 0;
+#if PACKED_TEXT_SIMD
+    // Читаются 16 байт, из них используются 12: после шага должно оставаться
+    // не меньше 2 групп, чтобы не выйти за конец данных
+    const __m128i low24 = _mm_set1_epi64x(0x0000000000FFFFFFLL);
+    const __m128i high24 = _mm_set1_epi64x(0x00FFFFFF00000000LL);
+    const __m128i lowHalf = _mm_set_epi64x(0, -1);
+    for (; g + 6 <= groups; g += 4) {
+        __m128i r = _mm_loadu_si128((const __m128i*)(in + 3 * g));
+        // Байты 6..11 переносятся в старшую половину, затем каждая
+        // 24-битная группа - в свой 32-битный элемент
+        __m128i v = _mm_or_si128(_mm_and_si128(r, lowHalf), _mm_andnot_si128(lowHalf, _mm_slli_si128(r, 2)));
+        v = _mm_or_si128(_mm_and_si128(v, low24), _mm_and_si128(_mm_slli_epi64(v, 8), high24));
+        __m128i x = _mm_and_si128(v, _mm_set1_epi32(0x3F));
+        x = _mm_or_si128(x, _mm_and_si128(_mm_slli_epi32(v, 2), _mm_set1_epi32(0x3F00)));
+        x = _mm_or_si128(x, _mm_and_si128(_mm_slli_epi32(v, 4), _mm_set1_epi32(0x3F0000)));
+        x = _mm_or_si128(x, _mm_and_si128(_mm_slli_epi32(v, 6), _mm_set1_epi32(0x3F000000)));
+        _mm_storeu_si128((__m128i*)(idx + 4 * g), x);
+    }
+#endif
+    for (; g < groups; g++) {
+        const unsigned char* p = in + 3 * g;
+        uint32_t v = p[0] | p[1] << 8 | p[2] << 16;
+        for (int k = 0; k < 4; k++) {
+            idx[4 * g + k] = (v >> (6 * k)) & 0x3F;
+        }
+    }
+}
+
+} // namespace
+
+// Упаковка шифртекста
+packedText::packedText(const std::wstring& cipher_text, cipherType ctype)
+{
+    if (cipher_text.empty())
+        throw packed_text_error("Empty cipher text");
+    if (!knownType(ctype))
+        throw packed_text_error("Unknown cipher type");
+
+    type = ctype;
+    length = cipher_text.size();
+    data.assign(packedSize(length), '\0');
+
+    unsigned char idx[chunk];
+    for (size_t pos = 0; pos < length; pos += chunk) {
+        size_t n = std::min(chunk, length - pos);
+        size_t bad = toIndices(cipher_text.data() + pos, n, idx);
+        if (bad != n) {
+            throw packed_text_error("Cipher text must contain only uppercase Russian letters (position "
+                                    + std::to_string(pos + bad) + ")");
+        }
+        // Неполная последняя группа дополняется нулями
+        std::memset(idx + n, 0, (4 - n % 4) % 4);
+        packGroups(idx, (n + 3) / 4, (unsigned char*)&data[pos / 4 * 3]);
+    }
+}
+
+// Чтение контейнера
+packedText::packedText(const std::string& bytes)
+{
+    if (bytes.size() < headerSize || std::memcmp(bytes.data(), magic, 4) != 0)
+        throw packed_text_error("Not a packed cipher text");
+    if ((unsigned char)bytes[4] != formatVersion)
+        throw packed_text_error("Unsupported packed text version");
+    if ((unsigned char)bytes[6] != russianAlphabet)
+        throw packed_text_error("Unsupported alphabet");
+
+    type = (cipherType)bytes[5];
+    if (!knownType(type))
+        throw packed_text_error("Unknown cipher type");
+
+    uint64_t letters = getLE(bytes, 8, 8);
+    size_t payload = bytes.size() - headerSize;
+    if (letters == 0 || letters > payload / 3 * 4 || packedSize(letters) != payload)
+        throw packed_text_error("Invalid packed text length");
+    length = letters;
+    data = bytes.substr(headerSize);
+
+    if (((unsigned char)bytes[7] & flagChecksum) && getLE(bytes, 16, 4) != checksum(bytes.data(), data))
+        throw packed_text_error("Packed text checksum mismatch");
+
+    checkIndices();
+}
+
+// Проверка, что все индексы соответствуют буквам алфавита
+void packedText::checkIndices()
+{
+    unsigned char idx[chunk];
+    for (size_t pos = 0; pos < length; pos += chunk) {
+        size_t n = std::min(chunk, length - pos);
+        unpackIndices(pos, n, idx);
+        for (size_t i = 0; i < n; i++) {
+            if (idx[i] >= numAlpha.size()) {
+                throw packed_text_error("Invalid letter in packed text (position "
+                                        + std::to_string(pos + i) + ")");
+            }
+        }
+    }
+}
+
+std::string packedText::toBytes(bool withChecksum) const
+{
+    std::string out(magic, 4);
+    out.push_back(formatVersion);
+    out.push_back((char)type);
+    out.push_back(russianAlphabet);
+    out.push_back(withChecksum ? flagChecksum : 0);
+    putLE(out, length, 8);
+    putLE(out, withChecksum ? checksum(out.data(), data) : 0, 4);
+    out += data;
+    return out;
+}
+
+std::wstring packedText::unpack() const
+{
+    std::wstring result(length, L'\0');
+    unsigned char idx[chunk];
+    for (size_t pos = 0; pos < length; pos += chunk) {
+        size_t n = std::min(chunk, length - pos);
+        unpackIndices(pos, n, idx);
+        toLetters(idx, n, &result[pos]);
+    }
+    return result;
+}
+
+// Начало и конец диапазона, не кратные 4, распаковываются по одной букве
+void packedText::unpackIndices(size_t pos, size_t count, unsigned char* out) const
+{
+    if (pos > length || count > length - pos)
+        throw packed_text_error("Range is out of packed text");
+
+    while (count > 0 && pos % 4 != 0) {
+        *out++ = letterAt(pos++);
+        count--;
+    }
+
+    size_t groups = count / 4;
+    unpackGroups((const unsigned char*)data.data() + pos / 4 * 3, groups, out);
+    out += groups * 4;
+    pos += groups * 4;
+    count -= groups * 4;
+
+    while (count > 0) {
+        *out++ = letterAt(pos++);
+        count--;
+    }
+}
+
+int packedText::letterAt(size_t i) const
+{
+    if (i >= length)
+        throw packed_text_error("Position is out of packed text");
+
+    const unsigned char* p = (const unsigned char*)data.data() + i / 4 * 3;
+    uint32_t v = p[0] | p[1] << 8 | p[2] << 16;
+    return (v >> (6 * (i % 4))) & 0x3F;
+}
@@ -0,0 +1,62 @@
+#pragma once
+#include <string>
+#include <stdexcept>
+#include "russianAlphabet.h"
+
+class packed_text_error : public std::invalid_argument {
+public:
+    explicit packed_text_error(const std::string& what_arg) :
+        std::invalid_argument(what_arg) {}
+    explicit packed_text_error(const char* what_arg) :
+        std::invalid_argument(what_arg) {}
+};
+
+// Шифр, которым получен упакованный текст
+enum class cipherType : unsigned char {
+    gronsfeld = 1,
+    route = 2
+};
+
+// Компактное хранение шифртекста: индексы 33 букв алфавита по 6 бит,
+// 4 буквы в 3 байтах.
+//
+// Формат контейнера (целые числа - little-endian):
+//   0  "CPK6"          сигнатура
+//   4  версия          1 байт
+//   5  cipherType      1 байт
+//   6  алфавит         1 байт, 1 - русский из 33 букв
+//   7  флаги           1 байт, бит 0 - контрольная сумма заполнена
+//   8  длина           8 байт, число букв
+//   16 контр. сумма    4 байта, FNV-1a байтов 0..15 заголовка и упакованных данных
+//   20 данные          (длина + 3) / 4 * 3 байт
+class packedText
+{
+private:
+    std::wstring numAlpha = russianLetters;
+    cipherType type;
+    size_t length;
+    std::string data;   // упакованные индексы букв
+
+    void checkIndices();
+
+public:
+    packedText() = delete;
+    // Упаковка шифртекста из прописных букв алфавита
+    packedText(const std::wstring& cipher_text, cipherType ctype);
+    // Чтение контейнера с проверкой заголовка и контрольной суммы
+    explicit packedText(const std::string& bytes);
+
+    // Запись контейнера
+    std::string toBytes(bool withChecksum = true) const;
+    // Распаковка в строку
+    std::wstring unpack() const;
+
+    // Индексы букв [pos, pos + count) в out без создания строки
+    void unpackIndices(size_t pos, size_t count, unsigned char* out) const;
+    // Индекс буквы с номером i
+    int letterAt(size_t i) const;
+
+    size_t size() const { return length; }
+    cipherType getType() const { return type; }
+    const std::wstring& alphabet() const { return numAlpha; }
+};
@@ -0,0 +1,149 @@
+#include "russianAlphabet.h"
+#include <cwchar>
+
+// При наличии SSE2 и 32-битного wchar_t проверка идет по 8 символов за шаг,
+// нормализация - по 4, перевод в индексы и обратно - по 16
+#if defined(__SSE2__) && WCHAR_MAX > 0xFFFF
+#include <emmintrin.h>
+#define RU_TEXT_SIMD 1
+#else
+#define RU_TEXT_SIMD 0
+#endif
+
+namespace {
+
+#if RU_TEXT_SIMD
+// Маска прописных букв в 4 символах
+inline __m128i upperMask(__m128i v)
+{
+    __m128i x = _mm_sub_epi32(v, _mm_set1_epi32(0x410));
+    __m128i range = _mm_and_si128(_mm_cmpgt_epi32(x, _mm_set1_epi32(-1)),
+                                  _mm_cmplt_epi32(x, _mm_set1_epi32(0x20)));
+    return _mm_or_si128(range, _mm_cmpeq_epi32(v, _mm_set1_epi32(0x401)));
+}
+#endif
+
+} // namespace
+
+size_t findInvalidUpper(const wchar_t* s, size_t len)
+{
+    size_t i = 0;
+#if RU_TEXT_SIMD
+    for (; i + 8 <= len; i += 8) {
+        __m128i a = upperMask(_mm_loadu_si128((const __m128i*)(s + i)));
+        __m128i b = upperMask(_mm_loadu_si128((const __m128i*)(s + i + 4)));
+        if (_mm_movemask_epi8(_mm_and_si128(a, b)) != 0xFFFF)
+            break;
+    }
+#endif
+    for (; i < len; i++) {
+        if (!isUpperLetter(s[i]))
+            return i;
+    }
+    return len;
+}
+
+size_t compactLetters(const wchar_t* s, size_t len, wchar_t* out)
+{
+    size_t n = 0;
+    size_t i = 0;
+#if RU_TEXT_SIMD
+    const __m128i minusOne = _mm_set1_epi32(-1);
+    const __m128i width = _mm_set1_epi32(0x20);
+    const __m128i upperYo = _mm_set1_epi32(0x401);
+    for (; i + 4 <= len; i += 4) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(s + i));
+        __m128i upper = upperMask(v);
+        __m128i y = _mm_sub_epi32(v, _mm_set1_epi32(0x430));
+        __m128i lower = _mm_and_si128(_mm_cmpgt_epi32(y, minusOne), _mm_cmplt_epi32(y, width));
+        __m128i lowerYo = _mm_cmpeq_epi32(v, _mm_set1_epi32(0x451));
+
+        // а..я -> А..Я вычитанием 0x20, ё -> Ё заменой
+        __m128i folded = _mm_sub_epi32(v, _mm_and_si128(lower, width));
+        folded = _mm_or_si128(_mm_andnot_si128(lowerYo, folded), _mm_and_si128(lowerYo, upperYo));
+
+        int keep = _mm_movemask_ps(_mm_castsi128_ps(_mm_or_si128(_mm_or_si128(upper, lower), lowerYo)));
+        if (keep == 0xF) {
+            _mm_storeu_si128((__m128i*)(out + n), folded);
+            n += 4;
+        } else if (keep != 0) {
+            wchar_t lanes[4];
+            _mm_storeu_si128((__m128i*)lanes, folded);
+            for (int k = 0; k < 4; k++) {
+                if (keep & (1 << k))
+                    out[n++] = lanes[k];
+            }
+        }
+    }
+#endif
+    for (; i < len; i++) {
+        wchar_t c = s[i];
+        if (isUpperLetter(c)) {
+            out[n++] = c;
+        } else if (c == 0x451) {
+            out[n++] = 0x401;
+        } else if (isLowerLetter(c)) {
+            out[n++] = c - 0x20;
+        }
+    }
+    return n;
+}
+
+size_t toIndices(const wchar_t* s, size_t n, unsigned char* out)
+{
+    size_t i = 0;
+#if RU_TEXT_SIMD
+    const __m128i first = _mm_set1_epi32(0x410);
+    for (; i + 16 <= n; i += 16) {
+        __m128i idx[4];
+        __m128i valid = _mm_set1_epi32(-1);
+        for (int k = 0; k < 4; k++) {
+            __m128i c = _mm_loadu_si128((const __m128i*)(s + i + 4 * k));
+            __m128i isYo = _mm_cmpeq_epi32(c, _mm_set1_epi32(0x401));
+            valid = _mm_and_si128(valid, upperMask(c));
+            // Буквы после Е сдвигаются на одну позицию, Ё получает индекс 6
+            __m128i x = _mm_sub_epi32(_mm_sub_epi32(c, first), _mm_cmpgt_epi32(c, _mm_set1_epi32(0x415)));
+            idx[k] = _mm_or_si128(_mm_andnot_si128(isYo, x), _mm_and_si128(isYo, _mm_set1_epi32(6)));
+        }
+        if (_mm_movemask_epi8(valid) != 0xFFFF)
+            break;
+        __m128i bytes = _mm_packus_epi16(_mm_packs_epi32(idx[0], idx[1]), _mm_packs_epi32(idx[2], idx[3]));
+        _mm_storeu_si128((__m128i*)(out + i), bytes);
+    }
+#endif
+    for (; i < n; i++) {
+        int idx = letterIndex(s[i]);
+        if (idx < 0)
+            return i;
+        out[i] = idx;
+    }
+    return n;
+}
+
+void toLetters(const unsigned char* idx, size_t n, wchar_t* out)
+{
+    size_t i = 0;
+#if RU_TEXT_SIMD
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i six = _mm_set1_epi32(6);
+    for (; i + 16 <= n; i += 16) {
+        __m128i bytes = _mm_loadu_si128((const __m128i*)(idx + i));
+        __m128i lo = _mm_unpacklo_epi8(bytes, zero);
+        __m128i hi = _mm_unpackhi_epi8(bytes, zero);
+        __m128i lanes[4] = {
+            _mm_unpacklo_epi16(lo, zero), _mm_unpackhi_epi16(lo, zero),
+            _mm_unpacklo_epi16(hi, zero), _mm_unpackhi_epi16(hi, zero)
+        };
+        for (int k = 0; k < 4; k++) {
+            __m128i v = lanes[k];
+            __m128i isYo = _mm_cmpeq_epi32(v, six);
+            __m128i c = _mm_add_epi32(_mm_add_epi32(v, _mm_set1_epi32(0x410)), _mm_cmpgt_epi32(v, six));
+            c = _mm_or_si128(_mm_andnot_si128(isYo, c), _mm_and_si128(isYo, _mm_set1_epi32(0x401)));
+            _mm_storeu_si128((__m128i*)(out + i + 4 * k), c);
+        }
+    }
+#endif
+    for (; i < n; i++) {
+        out[i] = indexLetter(idx[i]);
+    }
+}
@@ -0,0 +1,61 @@
+#pragma once
+#include <cstddef>
+
+// Алфавит шифров и быстрые операции над текстом, общие для всех модулей.
+//
+// Алфавит проверяется сравнениями диапазонов кодов вместо вызовов локали:
+// прописные А..Я - U+0410..U+042F и Ё - U+0401,
+// строчные  а..я - U+0430..U+044F и ё - U+0451.
+// Индекс буквы - ее позиция в russianLetters: А..Е - 0..5, Ё - 6, Ж..Я - 7..32
+
+const wchar_t russianLetters[] = L"АБВГДЕЁЖЗИЙКЛМНОПРСТУФХЦЧШЩЪЫЬЭЮЯ";
+const size_t alphabetSize = 33;
+
+inline bool isUpperLetter(wchar_t c)
+{
+    return (unsigned long)(c - 0x410) < 0x20 || c == 0x401;
+}
+
+inline bool isLowerLetter(wchar_t c)
+{
+    return (unsigned long)(c - 0x430) < 0x20 || c == 0x451;
+}
+
+// Строчная буква переводится в прописную, остальные символы не меняются
+inline wchar_t toUpperLetter(wchar_t c)
+{
+    if (c == 0x451)
+        return 0x401;
+    return isLowerLetter(c) ? c - 0x20 : c;
+}
+
+// Индекс прописной буквы или -1 для остальных символов
+inline int letterIndex(wchar_t c)
+{
+    if (c == 0x401)
+        return 6;
+    if ((unsigned long)(c - 0x410) >= 0x20)
+        return -1;
+    return c - 0x410 + (c > 0x415 ? 1 : 0);
+}
+
+// Буква по индексу 0..32
+inline wchar_t indexLetter(unsigned char idx)
+{
+    if (idx == 6)
+        return 0x401;
+    return 0x410 + idx - (idx > 6 ? 1 : 0);
+}
+
+// Позиция первого символа, не являющегося прописной буквой, или len
+size_t findInvalidUpper(const wchar_t* s, size_t len);
+
+// Удаление небукв с переводом в верхний регистр.
+// out должен вмещать len символов, допускается out == s. Возвращает новую длину
+size_t compactLetters(const wchar_t* s, size_t len, wchar_t* out);
+
+// Перевод прописных букв в индексы. Возвращает позицию первого неверного символа или n
+size_t toIndices(const wchar_t* s, size_t n, unsigned char* out);
+
+// Перевод индексов в буквы
+void toLetters(const unsigned char* idx, size_t n, wchar_t* out);
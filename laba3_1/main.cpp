@@ -1,5 +1,6 @@
 #include <UnitTest++/UnitTest++.h>
 #include "routeCipher.h"
+#include "routeCracker.h"
 #include <locale>
 #include <algorithm>
 #include <string>
@@ -112,6 +113,11 @@ SUITE(RouteEncryptTest)
         routeCipher cipher(1);
         CHECK(cipher.encrypt(L"АБВГД") == L"АБВГД");
     }
+    
+    TEST(LongMixedString) {
+        routeCipher cipher(1);
+        CHECK(cipher.encrypt(L"аБв1Гд  еЁЖз,,,,ИйкЛ12345678мНоп.рСтУ ёe") == L"АБВГДЕЁЖЗИЙКЛМНОПРСТУЁ");
+    }
 }
 
 // ==================== ТЕСТЫ ДЛЯ МЕТОДА DECRYPT ====================
@@ -138,6 +144,16 @@ SUITE(RouteDecryptTest)
         CHECK_THROW(p->decrypt(L"Г,Ж.В!Ё?Б-Е:А;Д"), route_cipher_error);
     }
     
+    TEST_FIXTURE(RouteFixture4, InvalidPosition) {
+        string what;
+        try {
+            p->decrypt(L"ГЖВЁБЕАДГЖВЁБЕАДГЖВё");
+        } catch (const route_cipher_error& e) {
+            what = e.what();
+        }
+        CHECK(what.find("uppercase (position 19)") != string::npos);
+    }
+    
     TEST_FIXTURE(RouteFixture4, EmptyCipherText) {
         CHECK_THROW(p->decrypt(L""), route_cipher_error);
     }
@@ -176,6 +192,145 @@ SUITE(RouteDecryptTest)
     }
 }
 
+// ==================== ТЕСТЫ ДЛЯ ПЕРЕСТАНОВКИ "НА МЕСТЕ" ====================
+
+SUITE(RouteInPlaceTest)
+{
+    TEST_FIXTURE(RouteFixture4, EncryptInPlace) {
+        wstring text = L"АБВГДЕЁЖ";
+        p->encryptInPlace(text);
+        CHECK(text == L"ГЖВЁБЕАД");
+    }
+    
+    TEST_FIXTURE(RouteFixture4, DecryptInPlace) {
+        wstring text = L"ГВЁБЕАД";
+        p->decryptInPlace(text);
+        CHECK(text == L"АБВГДЕЁ");
+    }
+    
+    TEST(MatchesEncryptForAllSizes) {
+        wstring alphabet = L"АБВГДЕЁЖЗИЙКЛМНОПРСТУФХЦЧШЩЪЫЬЭЮЯ";
+        bool ok = true;
+        for (int cols = 1; cols <= 12; cols++) {
+            routeCipher cipher(cols);
+            for (size_t len = 1; len <= alphabet.size(); len++) {
+                wstring text = alphabet.substr(0, len);
+                wstring encrypted = cipher.encrypt(text);
+                cipher.encryptInPlace(&text[0], text.size());
+                ok = ok && (text == encrypted);
+                cipher.decryptInPlace(&text[0], text.size());
+                ok = ok && (text == alphabet.substr(0, len));
+            }
+        }
+        CHECK(ok);
+    }
+    
+    TEST_FIXTURE(RouteFixture4, NotNormalizedText) {
+        wstring text = L"АБ ВГ";
+        CHECK_THROW(p->encryptInPlace(text), route_cipher_error);
+        CHECK(text == L"АБ ВГ");
+    }
+    
+    TEST_FIXTURE(RouteFixture4, EmptyText) {
+        wstring text;
+        CHECK_THROW(p->decryptInPlace(text), route_cipher_error);
+    }
+    
+    TEST_FIXTURE(RouteFixture4, Positions) {
+        bool ok = true;
+        for (size_t k = 0; k < 7; k++) {
+            ok = ok && p->decryptPos(p->encryptPos(k, 7), 7) == k;
+        }
+        CHECK(ok);
+        CHECK_THROW(p->encryptPos(7, 7), route_cipher_error);
+        CHECK_THROW(p->decryptPos(0, 0), route_cipher_error);
+    }
+}
+
+// ==================== ТЕСТЫ ДЛЯ ПЕРЕБОРА ЧИСЛА СТОЛБЦОВ ====================
+
+const wchar_t* sampleText =
+    L"Ранним утром город медленно просыпался. По широким улицам проезжали первые трамваи, "
+    L"дворники сметали с тротуаров опавшие листья, а в окнах домов один за другим загорались огни. "
+    L"На центральной площади открывались небольшие магазины и кофейни, и запах свежего хлеба разносился "
+    L"далеко вокруг. Старый учитель истории, как всегда, вышел из дома ровно в семь часов и неторопливо "
+    L"направился к школе. Он любил эти утренние прогулки, когда можно спокойно подумать о предстоящих уроках "
+    L"и вспомнить прочитанные накануне книги.";
+
+SUITE(RouteCrackerTest)
+{
+    // На 430 буквах примера лидер явный до 24 столбцов, на 860 - до 42
+    TEST(FindColumns) {
+        wstring letters = routeCipher(1).encrypt(sampleText);
+        letters += letters;
+        bool ok = true;
+        for (int cols = 2; cols <= 40; cols++) {
+            ok = ok && routeCracker(routeCipher(cols).encrypt(letters)).findColumns() == cols;
+        }
+        CHECK(ok);
+    }
+    
+    TEST(Crack) {
+        routeCipher cipher(17);
+        wstring encrypted = cipher.encrypt(sampleText);
+        CHECK(routeCracker(encrypted).crack() == cipher.decrypt(encrypted));
+    }
+    
+    TEST(ShortText) {
+        CHECK(routeCracker(L"А").crack() == L"А");
+    }
+    
+    // Около maxColumns строки короткие, и лидер становится явным только на 2580 буквах
+    TEST(NearMaxColumns) {
+        wstring sample = routeCipher(1).encrypt(sampleText);
+        wstring letters;
+        for (int i = 0; i < 6; i++) {
+            letters += sample;
+        }
+        bool ok = true;
+        for (int cols = routeCipher::maxColumns - 5; cols <= routeCipher::maxColumns; cols++) {
+            ok = ok && routeCracker(routeCipher(cols).encrypt(letters)).findColumns() == cols;
+        }
+        CHECK(ok);
+    }
+    
+    // На 150 буквах оценка не разделяет кандидатов: число столбцов не угадывается,
+    // а верное остается среди неразличимых
+    TEST(AmbiguousShortText) {
+        wstring letters = routeCipher(1).encrypt(sampleText).substr(0, 150);
+        for (int cols : {20, 97}) {
+            routeCracker cracker(routeCipher(cols).encrypt(letters));
+            vector<int> ranking = cracker.rankColumns();
+            CHECK(ranking.size() > 1);
+            CHECK(find(ranking.begin(), ranking.end(), cols) != ranking.end());
+            CHECK_THROW(cracker.findColumns(), route_cipher_error);
+            CHECK_THROW(cracker.crack(), route_cipher_error);
+        }
+    }
+    
+    TEST(InvalidCipherText) {
+        CHECK_THROW(routeCracker(L""), route_cipher_error);
+        CHECK_THROW(routeCracker(L"ГЖ ВЁБ"), route_cipher_error);
+    }
+}
+
+// ==================== ТЕСТЫ ДЛЯ УПАКОВАННОГО ФОРМАТА ====================
+
+SUITE(RoutePackedTest)
+{
+    TEST(DecryptPacked) {
+        routeCipher cipher(7);
+        wstring encrypted = cipher.encrypt(sampleText);
+        packedText packed(packedText(encrypted, cipherType::route).toBytes());
+        CHECK(cipher.decrypt(packed) == cipher.decrypt(encrypted));
+    }
+    
+    TEST_FIXTURE(RouteFixture4, WrongCipher) {
+        packedText packed(L"ГЖВЁБЕАД", cipherType::gronsfeld);
+        CHECK_THROW(p->decrypt(packed), route_cipher_error);
+    }
+}
+
 // ==================== ГЛАВНАЯ ФУНКЦИЯ ====================
 
 int main()
@@ -189,9 +344,12 @@ int main()
     
     wcout << L"Выполняются тесты:" << endl;
     wcout << L"1. RouteConstructorTest - 6 тестов" << endl;
-    wcout << L"2. RouteEncryptTest - 11 тестов" << endl;
-    wcout << L"3. RouteDecryptTest - 10 тестов" << endl;
-    wcout << L"Всего: 27 тестов" << endl << endl;
+    wcout << L"2. RouteEncryptTest - 12 тестов" << endl;
+    wcout << L"3. RouteDecryptTest - 11 тестов" << endl;
+    wcout << L"4. RouteInPlaceTest - 6 тестов" << endl;
+    wcout << L"5. RouteCrackerTest - 6 тестов" << endl;
+    wcout << L"6. RoutePackedTest - 2 теста" << endl;
+    wcout << L"Всего: 43 теста" << endl << endl;
     
     // Запуск всех тестов
     int result = UnitTest::RunAllTests();
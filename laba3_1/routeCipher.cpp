@@ -1,4 +1,5 @@
 #include "routeCipher.h"
+#include "russianAlphabet.h"
 #include <algorithm>
 #include <cctype>
 #include <locale>
@@ -20,7 +21,7 @@ void routeCipher::validateColumns(int cols)
     if (cols <= 0) {
         throw route_cipher_error("Number of columns must be positive");
     }
-    if (cols > 100) {
+    if (cols > maxColumns) {
         throw route_cipher_error("Number of columns is too large");
     }
 }
@@ -31,30 +32,14 @@ std::wstring routeCipher::getValidOpenText(const std::wstring& s)
         throw route_cipher_error("Empty open text");
     }
     
-    std::wstring result;
-    std::locale loc("ru_RU.UTF-8");
+    std::wstring result(s.size(), L'\0');
+    result.resize(compactLetters(s.data(), s.size(), &result[0]));
     
-    for (wchar_t c : s) {
-        if (iswalpha(c) || c == L' ') {
-            if (iswalpha(c)) {
-                c = towupper(c);
-            }
-            result += c;
-        }
-    }
-    
-    std::wstring textWithoutSpaces;
-    for (wchar_t c : result) {
-        if (c != L' ') {
-            textWithoutSpaces += c;
-        }
-    }
-    
-    if (textWithoutSpaces.empty()) {
+    if (result.empty()) {
         throw route_cipher_error("Open text contains no valid letters");
     }
     
-    return textWithoutSpaces;
+    return result;
 }
 
 std::wstring routeCipher::getValidCipherText(const std::wstring& s)
@@ -63,13 +48,12 @@ std::wstring routeCipher::getValidCipherText(const std::wstring& s)
         throw route_cipher_error("Empty cipher text");
     }
     
-    for (wchar_t c : s) {
-        if (!iswalpha(c)) {
-            throw route_cipher_error("Cipher text must contain only letters");
-        }
-        if (!iswupper(c)) {
-            throw route_cipher_error("Cipher text must be in uppercase");
+    size_t pos = findInvalidUpper(s.data(), s.size());
+    if (pos != s.size()) {
+        if (isLowerLetter(s[pos])) {
+            throw route_cipher_error("Cipher text must be in uppercase (position " + to_string(pos) + ")");
         }
+        throw route_cipher_error("Cipher text must contain only letters (position " + to_string(pos) + ")");
     }
     
     return s;
@@ -199,4 +183,122 @@ std::wstring routeCipher::decrypt(const std::wstring& text)
     }
     
     return result;
-}
\ No newline at end of file
+}
+
+void routeCipher::checkNormalizedText(const wchar_t* text, size_t len)
+{
+    if (len == 0) {
+        throw route_cipher_error("Empty text");
+    }
+    
+    size_t pos = findInvalidUpper(text, len);
+    if (pos != len) {
+        throw route_cipher_error("Text must contain only uppercase letters (position " + to_string(pos) + ")");
+    }
+}
+
+// Позиция в шифртексте символа с индексом k открытого текста.
+// Полные столбцы (высотой rows) - левые full, остальные короче на одну ячейку
+size_t routeCipher::encryptPos(size_t k, size_t len) const
+{
+    if (k >= len) {
+        throw route_cipher_error("Position is out of text");
+    }
+    
+    size_t cols = columns;
+    size_t rows = (len + cols - 1) / cols;
+    size_t full = cols - (rows * cols - len);
+    
+    size_t i = k / cols;
+    size_t j = k % cols;
+    
+    // Столбцы правее j читаются раньше
+    size_t offset = (cols - 1 - j) * (rows - 1);
+    if (j + 1 < full) {
+        offset += full - 1 - j;
+    }
+    return offset + i;
+}
+
+// Позиция в открытом тексте символа с индексом p шифртекста
+size_t routeCipher::decryptPos(size_t p, size_t len) const
+{
+    if (p >= len) {
+        throw route_cipher_error("Position is out of text");
+    }
+    
+    size_t cols = columns;
+    size_t rows = (len + cols - 1) / cols;
+    size_t empty = rows * cols - len;
+    size_t full = cols - empty;
+    
+    size_t i, j;
+    // Сначала читаются короткие правые столбцы
+    if (p < empty * (rows - 1)) {
+        j = cols - 1 - p / (rows - 1);
+        i = p % (rows - 1);
+    } else {
+        size_t q = p - empty * (rows - 1);
+        j = full - 1 - q / rows;
+        i = q % rows;
+    }
+    return i * cols + j;
+}
+
+// Перестановка по циклам: каждый символ сразу ставится на свое место
+void routeCipher::permuteInPlace(wchar_t* text, size_t len, bool inverse)
+{
+    checkNormalizedText(text, len);
+    
+    vector<bool> visited(len, false);
+    for (size_t start = 0; start < len; start++) {
+        if (visited[start]) {
+            continue;
+        }
+        
+        wchar_t carried = text[start];
+        size_t k = start;
+        do {
+            size_t d = inverse ? decryptPos(k, len) : encryptPos(k, len);
+            std::swap(carried, text[d]);
+            visited[d] = true;
+            k = d;
+        } while (k != start);
+    }
+}
+
+// Каждая буква открытого текста читается прямо из упакованных данных
+std::wstring routeCipher::decrypt(const packedText& packed)
+{
+    if (packed.getType() != cipherType::route) {
+        throw route_cipher_error("Packed text was produced by another cipher");
+    }
+    
+    size_t len = packed.size();
+    const std::wstring& alphabet = packed.alphabet();
+    std::wstring result(len, L'\0');
+    for (size_t k = 0; k < len; k++) {
+        result[k] = alphabet[packed.letterAt(encryptPos(k, len))];
+    }
+    return result;
+}
+
+void routeCipher::encryptInPlace(wchar_t* text, size_t len)
+{
+    permuteInPlace(text, len, false);
+}
+
+void routeCipher::decryptInPlace(wchar_t* text, size_t len)
+{
+    permuteInPlace(text, len, true);
+}
+
+void routeCipher::encryptInPlace(std::wstring& text)
+{
+    permuteInPlace(&text[0], text.size(), false);
+}
+
+void routeCipher::decryptInPlace(std::wstring& text)
+{
+    permuteInPlace(&text[0], text.size(), true);
+}
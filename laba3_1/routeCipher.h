@@ -3,6 +3,7 @@
 #include <string>
 #include <stdexcept>
 #include <locale>
+#include "packedText.h"
 
 class route_cipher_error : public std::invalid_argument {
 public:
@@ -21,11 +22,32 @@ private:
     void validateColumns(int cols);
     std::wstring getValidOpenText(const std::wstring& s);
     std::wstring getValidCipherText(const std::wstring& s);
+    void checkNormalizedText(const wchar_t* text, size_t len);
+
+    void permuteInPlace(wchar_t* text, size_t len, bool inverse);
 
 public:
+    static const int maxColumns = 100;
+
     routeCipher() = delete;
     routeCipher(int cols);
 
     std::wstring encrypt(const std::wstring& text);
     std::wstring decrypt(const std::wstring& text);
+    // Расшифрование упакованного шифртекста без распаковки в строку
+    std::wstring decrypt(const packedText& packed);
+
+    // Перестановка "на месте" следованием по циклам, доп. память - 1 бит на символ.
+    // Текст должен быть уже нормализован (только прописные буквы)
+    void encryptInPlace(wchar_t* text, size_t len);
+    void decryptInPlace(wchar_t* text, size_t len);
+    void encryptInPlace(std::wstring& text);
+    void decryptInPlace(std::wstring& text);
+
+    // Позиции символов в таблице маршрута без построения самой таблицы:
+    // encryptPos - место символа k открытого текста в шифртексте длины len,
+    // decryptPos - место символа p шифртекста в открытом тексте.
+    // Позиция должна быть меньше len, иначе route_cipher_error
+    size_t encryptPos(size_t k, size_t len) const;
+    size_t decryptPos(size_t p, size_t len) const;
 };
\ No newline at end of file
@@ -0,0 +1,246 @@
+#include "routeCracker.h"
+#include "russianAlphabet.h"
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <thread>
+
+using namespace std;
+
+namespace {
+
+// Приближенные частоты самых распространенных биграмм русского языка (на 1000 биграмм)
+struct bigramFreq {
+    const wchar_t* pair;
+    double freq;
+};
+
+const bigramFreq frequentBigrams[] = {
+    {L"СТ", 16.0}, {L"НО", 13.4}, {L"ТО", 12.7}, {L"НА", 12.7}, {L"ЕН", 12.4},
+    {L"ОВ", 11.0}, {L"НИ", 10.9}, {L"РА", 10.4}, {L"ВО", 10.2}, {L"КО", 10.0},
+    {L"ЕР", 9.5}, {L"ПО", 9.3}, {L"ПР", 9.1}, {L"ЛИ", 8.9}, {L"ОР", 8.6},
+    {L"ЕТ", 8.4}, {L"ОС", 8.2}, {L"ТА", 8.2}, {L"ОЛ", 8.0}, {L"ГО", 7.8},
+    {L"АЛ", 7.7}, {L"ЕЛ", 7.4}, {L"НЕ", 7.4}, {L"РЕ", 7.3}, {L"ВА", 7.0},
+    {L"ЛА", 6.9}, {L"ОМ", 6.7}, {L"КА", 6.7}, {L"ОД", 6.5}, {L"ЛЕ", 6.5},
+    {L"ТЕ", 6.3}, {L"ЕС", 6.2}, {L"ОН", 6.1}, {L"ДЕ", 5.9}, {L"ОТ", 5.8},
+    {L"ТИ", 5.7}, {L"ЕВ", 5.5}, {L"ВЕ", 5.4}, {L"АН", 5.3}, {L"ИН", 5.2},
+    {L"ИЕ", 5.0}, {L"ЕМ", 5.0}, {L"ИЛ", 4.9}, {L"АТ", 4.8}, {L"РО", 4.8},
+    {L"ЛО", 4.6}, {L"МИ", 4.3}, {L"ДО", 4.3}, {L"ИТ", 4.2}, {L"ИС", 4.2},
+    {L"ЧТ", 4.0}, {L"ЕД", 4.0}, {L"ЕГ", 3.6}, {L"ОЙ", 3.5}, {L"АС", 3.5},
+    {L"ТЬ", 3.3}, {L"ЫЕ", 3.2}, {L"ЛЬ", 3.2}, {L"ИЙ", 3.0}, {L"ОБ", 3.0},
+    {L"АМ", 3.0}, {L"БЫ", 2.5}
+};
+
+// Частота остальных биграмм
+const double otherBigramFreq = 0.5;
+
+// Начальная длина префикса
+const size_t initialPrefix = 128;
+
+// Средняя по n биграммам разность оценок лидера и кандидата колеблется на
+// spread / sqrt(n), где spread - измеренный разброс разности для одной биграммы.
+// Кандидат отбрасывается при отставании больше marginSigmas таких колебаний
+const double marginSigmas = 3;
+
+} // namespace
+
+routeCracker::routeCracker(const std::wstring& cipher_text)
+{
+    text = getValidCipherText(cipher_text);
+    cipher = cipher_text;
+    buildModel();
+}
+
+// Валидация шифртекста и перевод букв в индексы алфавита
+std::vector<unsigned char> routeCracker::getValidCipherText(const std::wstring& s)
+{
+    if (s.empty()) {
+        throw route_cipher_error("Empty cipher text");
+    }
+
+    vector<unsigned char> result(s.size());
+    size_t pos = toIndices(s.data(), s.size(), result.data());
+    if (pos != s.size()) {
+        throw route_cipher_error("Cipher text must contain only uppercase Russian letters (position "
+                                 + to_string(pos) + ")");
+    }
+    return result;
+}
+
+void routeCracker::buildModel()
+{
+    const size_t m = alphabetSize;
+    bigramLog.assign(m * m, log(otherBigramFreq));
+    for (const bigramFreq& b : frequentBigrams) {
+        size_t first = letterIndex(b.pair[0]);
+        size_t second = letterIndex(b.pair[1]);
+        bigramLog[first * m + second] = log(b.freq);
+    }
+}
+
+// Буквы префикса берутся прямо из шифртекста по формуле маршрута,
+// полная расшифровка не выполняется
+double routeCracker::score(int cols, size_t prefix)
+{
+    const size_t m = alphabetSize;
+    const size_t len = text.size();
+    routeCipher route(cols);
+
+    if (prefix < 2)
+        return 0;
+
+    double sum = 0;
+    size_t prev = text[route.encryptPos(0, len)];
+    for (size_t k = 1; k < prefix; k++) {
+        size_t cur = text[route.encryptPos(k, len)];
+        sum += bigramLog[prev * m + cur];
+        prev = cur;
+    }
+    return sum / (prefix - 1);
+}
+
+// Оценки кандидата и лидера сравниваются на одних и тех же позициях открытого текста:
+// там, где расшифровки совпадают, разность нулевая и не добавляет разброса
+double routeCracker::compare(int cols, int leader, size_t prefix, double& spread)
+{
+    const size_t m = alphabetSize;
+    const size_t len = text.size();
+    routeCipher route(cols);
+    routeCipher best(leader);
+
+    spread = 0;
+    if (prefix < 2)
+        return 0;
+
+    double sum = 0;
+    double squares = 0;
+    size_t prev = text[route.encryptPos(0, len)];
+    size_t prevBest = text[best.encryptPos(0, len)];
+    for (size_t k = 1; k < prefix; k++) {
+        size_t cur = text[route.encryptPos(k, len)];
+        size_t curBest = text[best.encryptPos(k, len)];
+        double d = bigramLog[prevBest * m + curBest] - bigramLog[prev * m + cur];
+        sum += d;
+        squares += d * d;
+        prev = cur;
+        prevBest = curBest;
+    }
+    double n = prefix - 1;
+    double mean = sum / n;
+    spread = sqrt(max(0.0, squares / n - mean * mean));
+    return mean;
+}
+
+// Параллельный обход кандидатов: поток t берет каждый threads-й кандидат
+void routeCracker::forEachCandidate(size_t count, const std::function<void(size_t)>& f)
+{
+    size_t threads = thread::hardware_concurrency();
+    threads = max((size_t)1, min(threads, count));
+
+    auto worker = [&](size_t t) {
+        for (size_t i = t; i < count; i += threads) {
+            f(i);
+        }
+    };
+
+    vector<thread> pool;
+    for (size_t t = 1; t < threads; t++) {
+        pool.push_back(thread(worker, t));
+    }
+    worker(0);
+    for (auto& th : pool) {
+        th.join();
+    }
+}
+
+// Кандидаты сужаются с удлинением префикса, пока лидер не оторвется от остальных
+// или префикс не станет равен всему тексту
+std::vector<int> routeCracker::rankColumns()
+{
+    const size_t len = text.size();
+
+    // При числе столбцов не меньше длины текста перестановка одна и та же
+    int limit = routeCipher::maxColumns;
+    limit = min((size_t)limit, len);
+    vector<int> candidates;
+    for (int cols = 1; cols <= limit; cols++) {
+        candidates.push_back(cols);
+    }
+
+    size_t prefix = min(initialPrefix, len);
+    while (true) {
+        vector<double> scores(candidates.size());
+        forEachCandidate(candidates.size(), [&](size_t i) {
+            scores[i] = score(candidates[i], prefix);
+        });
+        // При равенстве оценок лидером остается меньшее число столбцов
+        int leader = candidates[max_element(scores.begin(), scores.end()) - scores.begin()];
+
+        vector<double> gaps(candidates.size());
+        vector<double> spreads(candidates.size());
+        forEachCandidate(candidates.size(), [&](size_t i) {
+            gaps[i] = compare(candidates[i], leader, prefix, spreads[i]);
+        });
+
+        // Отставание меньше marginSigmas колебаний средней разности
+        // не отличается от случайного, такой кандидат остается
+        double sigmas = marginSigmas / sqrt(max((size_t)1, prefix - 1));
+        vector<size_t> order;
+        for (size_t i = 0; i < candidates.size(); i++) {
+            if (candidates[i] == leader || gaps[i] <= 0 || gaps[i] < sigmas * spreads[i]) {
+                order.push_back(i);
+            }
+        }
+        stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+            return gaps[a] < gaps[b];
+        });
+        vector<int> survivors;
+        for (size_t i : order) {
+            survivors.push_back(candidates[i]);
+        }
+
+        if (survivors.size() == 1) {
+            return survivors;
+        }
+        if (prefix == len) {
+            return distinctDecryptions(survivors);
+        }
+
+        sort(survivors.begin(), survivors.end());
+        candidates = survivors;
+        prefix = min(prefix * 4, len);
+    }
+}
+
+// Разные числа столбцов могут давать одну и ту же расшифровку
+// (например, для текста из одинаковых букв) - такие кандидаты не различаются
+std::vector<int> routeCracker::distinctDecryptions(const std::vector<int>& ranking)
+{
+    vector<int> result;
+    vector<wstring> seen;
+    for (int cols : ranking) {
+        wstring decrypted = cipher;
+        routeCipher(cols).decryptInPlace(decrypted);
+        if (find(seen.begin(), seen.end(), decrypted) == seen.end()) {
+            result.push_back(cols);
+            seen.push_back(decrypted);
+        }
+    }
+    return result;
+}
+
+int routeCracker::findColumns()
+{
+    vector<int> ranking = rankColumns();
+    if (ranking.size() > 1) {
+        throw route_cipher_error("Number of columns is ambiguous - cipher text is too short");
+    }
+    return ranking[0];
+}
+
+std::wstring routeCracker::crack()
+{
+    wstring result = cipher;
+    routeCipher(findColumns()).decryptInPlace(result);
+    return result;
+}
@@ -0,0 +1,41 @@
+#pragma once
+#include <vector>
+#include <string>
+#include <functional>
+#include "routeCipher.h"
+
+// Полный перебор числа столбцов маршрутной перестановки.
+// Кандидаты оцениваются биграммной моделью русского языка по префиксу
+// открытого текста; префикс удлиняется, пока один кандидат не станет явным лидером.
+// Если лидер не отрывается и на всем тексте, число столбцов считается неоднозначным
+class routeCracker
+{
+private:
+    std::wstring cipher;
+    std::vector<unsigned char> text;   // индексы букв шифртекста
+    std::vector<double> bigramLog;     // логарифмы частот биграмм [first * 33 + second]
+
+    std::vector<unsigned char> getValidCipherText(const std::wstring& s);
+    void buildModel();
+
+    // Средняя оценка биграмм первых prefix букв расшифровки при cols столбцах
+    double score(int cols, size_t prefix);
+    // Среднее отставание cols от leader по биграммам тех же позиций;
+    // spread - стандартное отклонение отставания на одной биграмме
+    double compare(int cols, int leader, size_t prefix, double& spread);
+    void forEachCandidate(size_t count, const std::function<void(size_t)>& f);
+    std::vector<int> distinctDecryptions(const std::vector<int>& ranking);
+
+public:
+    routeCracker() = delete;
+    routeCracker(const std::wstring& cipher_text);
+
+    // Числа столбцов, которые оценка не смогла разделить, начиная с лучшего;
+    // один элемент - число столбцов определено надежно
+    std::vector<int> rankColumns();
+    // Надежно определенное число столбцов; если шифртекста недостаточно,
+    // чтобы отделить лидера, - route_cipher_error
+    int findColumns();
+    // Расшифрование с найденным числом столбцов
+    std::wstring crack();
+};